@@ -0,0 +1,223 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "synthetic.h"
+
+namespace Boiler { namespace gltf { namespace bench
+{
+	// Size of a generated asset with real geometry. Vertices are split evenly
+	// between meshCount meshes, each with one primitive of four accessors:
+	// POSITION and NORMAL floats interleaved in one strided bufferView,
+	// normalized unsigned short TEXCOORD_0 and indices, 16 bit where they
+	// fit. Meshes are dealt round robin into bufferCount buffers.
+	struct AssetSpec
+	{
+		unsigned int vertexCount = 100000;
+		unsigned int nodeCount = 1000;
+		unsigned int meshCount = 100;
+		unsigned int bufferCount = 1;
+		// a single buffer embedded as the BIN chunk rather than files
+		bool glb = false;
+		unsigned int seed = 1;
+
+		unsigned int accessorCount() const { return meshCount * 4; }
+	};
+
+	struct Asset
+	{
+		std::string json;
+		// buffers[i] holds the bytes of buffer i, named asset<i>.bin
+		std::vector<std::vector<std::byte>> buffers;
+
+		size_t bufferBytes() const
+		{
+			size_t bytes = 0;
+			for (const auto &buffer : buffers)
+			{
+				bytes += buffer.size();
+			}
+			return bytes;
+		}
+	};
+
+	namespace detail
+	{
+		template<typename T>
+		void append(std::vector<std::byte> &out, const T &value)
+		{
+			const size_t offset = out.size();
+			out.resize(offset + sizeof(T));
+			std::memcpy(out.data() + offset, &value, sizeof(T));
+		}
+
+		inline void align(std::vector<std::byte> &out, size_t alignment)
+		{
+			out.resize((out.size() + alignment - 1) / alignment * alignment);
+		}
+	}
+
+	// Builds the same asset for the same spec on every platform.
+	inline Asset generateAsset(AssetSpec spec)
+	{
+		if (spec.glb)
+		{
+			spec.bufferCount = 1;
+		}
+		spec.meshCount = std::max(1u, spec.meshCount);
+		spec.nodeCount = std::max(spec.nodeCount, spec.meshCount);
+		spec.bufferCount = std::max(1u, std::min(spec.bufferCount, spec.meshCount));
+
+		// mt19937's output is fixed by the standard, unlike the distributions,
+		// so floats in [-1, 1) come straight from its top 24 bits
+		std::mt19937 random(spec.seed);
+		const auto unit = [&random]() { return static_cast<float>(random() >> 8) * 0x1p-24f * 2.0f - 1.0f; };
+		Asset asset;
+		asset.buffers.resize(spec.bufferCount);
+
+		JsonWriter accessors, bufferViews, meshes;
+		for (unsigned int mesh = 0; mesh < spec.meshCount; ++mesh)
+		{
+			const unsigned int vertices = spec.vertexCount / spec.meshCount
+				+ (mesh < spec.vertexCount % spec.meshCount ? 1 : 0);
+			// a strip of quads, two triangles per four vertices
+			const unsigned int quads = vertices / 4;
+			const unsigned int indexCount = quads * 6;
+			// 65535 is the primitive restart value, which indices can't hold
+			const bool shortIndices = vertices < 65536;
+			const unsigned int buffer = mesh % spec.bufferCount;
+			std::vector<std::byte> &out = asset.buffers[buffer];
+
+			const unsigned int view = mesh * 3;
+			const size_t vertexOffset = out.size();
+			for (unsigned int v = 0; v < vertices; ++v)
+			{
+				const float position[3] = {unit(), unit(), unit()};
+				const float length = std::sqrt(position[0] * position[0] + position[1] * position[1]
+											   + position[2] * position[2]) + 1e-6f;
+				for (float value : position)
+				{
+					detail::append(out, value);
+				}
+				for (float value : position)
+				{
+					detail::append(out, value / length);
+				}
+			}
+			const size_t uvOffset = out.size();
+			for (unsigned int v = 0; v < vertices * 2; ++v)
+			{
+				detail::append(out, static_cast<uint16_t>(random() & 0xffff));
+			}
+			detail::align(out, 4);
+			const size_t indexOffset = out.size();
+			for (unsigned int quad = 0; quad < quads; ++quad)
+			{
+				const uint32_t base = quad * 4;
+				for (const uint32_t index : {base, base + 1, base + 2, base + 2, base + 1, base + 3})
+				{
+					if (shortIndices)
+					{
+						detail::append(out, static_cast<uint16_t>(index));
+					}
+					else
+					{
+						detail::append(out, index);
+					}
+				}
+			}
+			const size_t indexBytes = out.size() - indexOffset;
+			detail::align(out, 4);
+
+			bufferViews.comma(mesh > 0);
+			bufferViews.raw("{\"buffer\":").integer(buffer).raw(",\"byteOffset\":").integer(vertexOffset)
+				.raw(",\"byteLength\":").integer(vertices * 24ull).raw(",\"byteStride\":24,\"target\":34962},");
+			bufferViews.raw("{\"buffer\":").integer(buffer).raw(",\"byteOffset\":").integer(uvOffset)
+				.raw(",\"byteLength\":").integer(vertices * 4ull).raw(",\"target\":34962},");
+			bufferViews.raw("{\"buffer\":").integer(buffer).raw(",\"byteOffset\":").integer(indexOffset)
+				.raw(",\"byteLength\":").integer(indexBytes).raw(",\"target\":34963}");
+
+			accessors.comma(mesh > 0);
+			accessors.raw("{\"bufferView\":").integer(view).raw(",\"componentType\":5126,\"count\":").integer(vertices)
+				.raw(",\"type\":\"VEC3\",\"min\":[-1,-1,-1],\"max\":[1,1,1]},");
+			accessors.raw("{\"bufferView\":").integer(view).raw(",\"byteOffset\":12,\"componentType\":5126,\"count\":")
+				.integer(vertices).raw(",\"type\":\"VEC3\"},");
+			accessors.raw("{\"bufferView\":").integer(view + 1).raw(",\"componentType\":5123,\"normalized\":true,\"count\":")
+				.integer(vertices).raw(",\"type\":\"VEC2\"},");
+			accessors.raw("{\"bufferView\":").integer(view + 2).raw(",\"componentType\":")
+				.integer(shortIndices ? 5123 : 5125).raw(",\"count\":").integer(indexCount).raw(",\"type\":\"SCALAR\"}");
+
+			const unsigned long long accessor = mesh * 4ull;
+			meshes.comma(mesh > 0);
+			meshes.raw("{\"primitives\":[{\"attributes\":{\"POSITION\":").integer(accessor)
+				.raw(",\"NORMAL\":").integer(accessor + 1).raw(",\"TEXCOORD_0\":").integer(accessor + 2)
+				.raw("},\"indices\":").integer(accessor + 3).raw("}]}");
+		}
+
+		JsonWriter out;
+		out.raw("{\"asset\":{\"version\":\"2.0\",\"generator\":\"boiler-gltf synthetic\"},\"scene\":0,");
+		out.raw("\"scenes\":[{\"nodes\":[0]}],\"nodes\":[");
+		for (unsigned int i = 0; i < spec.nodeCount; ++i)
+		{
+			out.comma(i > 0);
+			out.raw("{\"translation\":[").number(unit()).raw(",").number(unit()).raw(",")
+				.number(unit()).raw("]");
+			if (i < spec.meshCount) out.raw(",\"mesh\":").integer(i);
+			const unsigned int left = 2 * i + 1, right = 2 * i + 2;
+			if (left < spec.nodeCount)
+			{
+				out.raw(",\"children\":[").integer(left);
+				if (right < spec.nodeCount) out.raw(",").integer(right);
+				out.raw("]");
+			}
+			out.raw("}");
+		}
+		out.raw("],\"meshes\":[").raw(meshes.take().c_str());
+		out.raw("],\"accessors\":[").raw(accessors.take().c_str());
+		out.raw("],\"bufferViews\":[").raw(bufferViews.take().c_str());
+		out.raw("],\"buffers\":[");
+		for (unsigned int i = 0; i < spec.bufferCount; ++i)
+		{
+			out.comma(i > 0);
+			out.raw("{");
+			if (!spec.glb) out.raw("\"uri\":\"asset").integer(i).raw(".bin\",");
+			out.raw("\"byteLength\":").integer(asset.buffers[i].size()).raw("}");
+		}
+		out.raw("]}");
+		asset.json = out.take();
+		return asset;
+	}
+
+	// Packs a single-buffer asset into a .glb container.
+	inline std::vector<std::byte> packGLB(const Asset &asset)
+	{
+		std::string json = asset.json;
+		json.resize((json.size() + 3) / 4 * 4, ' ');
+		std::vector<std::byte> bin = asset.buffers.empty() ? std::vector<std::byte>() : asset.buffers[0];
+		detail::align(bin, 4);
+
+		std::vector<std::byte> glb;
+		detail::append(glb, uint32_t(0x46546C67));
+		detail::append(glb, uint32_t(2));
+		detail::append(glb, static_cast<uint32_t>(12 + 8 + json.size() + (bin.empty() ? 0 : 8 + bin.size())));
+		detail::append(glb, static_cast<uint32_t>(json.size()));
+		detail::append(glb, uint32_t(0x4E4F534A));
+		glb.insert(glb.end(), reinterpret_cast<const std::byte *>(json.data()),
+				   reinterpret_cast<const std::byte *>(json.data() + json.size()));
+		if (!bin.empty())
+		{
+			detail::append(glb, static_cast<uint32_t>(bin.size()));
+			detail::append(glb, uint32_t(0x004E4942));
+			glb.insert(glb.end(), bin.begin(), bin.end());
+		}
+		return glb;
+	}
+}}}
+
+#endif /* ASSETS_H */
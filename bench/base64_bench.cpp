@@ -0,0 +1,72 @@
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base64.h"
+#include "benchutil.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	std::string encode(const std::vector<std::byte> &data)
+	{
+		constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		std::string encoded;
+		encoded.reserve((data.size() + 2) / 3 * 4);
+		for (size_t i = 0; i < data.size(); i += 3)
+		{
+			const size_t remaining = std::min<size_t>(3, data.size() - i);
+			uint32_t triple = 0;
+			for (size_t j = 0; j < remaining; ++j)
+			{
+				triple |= std::to_integer<uint32_t>(data[i + j]) << (16 - 8 * j);
+			}
+			for (size_t j = 0; j < 4; ++j)
+			{
+				encoded.push_back(j <= remaining ? alphabet[(triple >> (18 - 6 * j)) & 0x3F] : '=');
+			}
+		}
+		return encoded;
+	}
+}
+
+int main()
+{
+	std::mt19937 random(42);
+	std::printf("%-10s %14s %14s %8s\n", "bytes", "scalar MB/s", "vector MB/s", "speedup");
+
+	for (const size_t size : {1024u, 64u * 1024u, 1024u * 1024u, 16u * 1024u * 1024u})
+	{
+		std::vector<std::byte> data(size);
+		for (auto &value : data)
+		{
+			value = static_cast<std::byte>(random());
+		}
+		const std::string encoded = encode(data);
+		std::vector<std::byte> output(base64::decodedSize(encoded));
+
+		const int repetitions = size < 1024 * 1024 ? 200 : 10;
+		const double scalarTime = bench::measure([&]() {
+			bench::doNotOptimize(base64::decodeScalar(encoded, output));
+		}, repetitions);
+		const double vectorTime = bench::measure([&]() {
+			bench::doNotOptimize(base64::decode(encoded, output));
+		}, repetitions);
+
+		if (std::memcmp(output.data(), data.data(), size) != 0)
+		{
+			std::fprintf(stderr, "decoded output mismatch for %zu bytes\n", size);
+			return 1;
+		}
+
+		std::printf("%-10zu %14.1f %14.1f %7.2fx\n", size,
+					bench::megabytesPerSecond(encoded.size(), scalarTime),
+					bench::megabytesPerSecond(encoded.size(), vectorTime),
+					scalarTime / vectorTime);
+	}
+
+	return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+namespace Boiler { namespace gltf { namespace bench
+{
+	// Runs func repeatedly and returns the fastest run in seconds.
+	template<typename Func>
+	double measure(Func &&func, int repetitions = 10)
+	{
+		double best = std::numeric_limits<double>::max();
+		for (int i = 0; i < repetitions; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			func();
+			const auto end = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double>(end - start).count());
+		}
+		return best;
+	}
+
+	// Keeps the optimizer from discarding a benchmarked result.
+	template<typename T>
+	void doNotOptimize(const T &value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const T *sink;
+		sink = &value;
+#endif
+	}
+
+	inline double megabytesPerSecond(size_t bytes, double seconds)
+	{
+		return bytes / seconds / (1024.0 * 1024.0);
+	}
+}}}
+
+#endif /* BENCHUTIL_H */
@@ -0,0 +1,278 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "buffersource.h"
+#include "gltf.h"
+#include "modelaccessors.h"
+#include "assets.h"
+#include "benchutil.h"
+
+using namespace Boiler::gltf;
+
+// Times each stage of loading a generated asset on its own and prints one
+// JSON object per stage and asset, for tracking across releases:
+//
+//   gltf-bench [small|medium|large]... [--glb] [--vertices=N] [--nodes=N]
+//              [--meshes=N] [--buffers=N] [--repetitions=N]
+//
+// Without a preset, small and medium are run as .gltf and as .glb.
+
+namespace
+{
+	struct Preset
+	{
+		const char *name;
+		bench::AssetSpec spec;
+		int repetitions;
+	};
+
+	const Preset presets[] = {
+		{"small", {10000, 100, 10, 1}, 20},
+		{"medium", {1000000, 10000, 1000, 4}, 5},
+		{"large", {4000000, 100000, 4000, 16}, 3},
+	};
+
+	struct Record
+	{
+		const char *benchmark;
+		size_t bytes;
+		size_t elements;
+		double seconds;
+	};
+
+	void print(const char *asset, const bench::AssetSpec &spec, const Record &record)
+	{
+		std::printf("{\"benchmark\":\"%s\",\"asset\":\"%s\",\"format\":\"%s\",\"vertices\":%u,\"nodes\":%u,"
+					"\"accessors\":%u,\"buffers\":%u,\"bytes\":%zu,\"elements\":%zu,\"seconds\":%.9f,"
+					"\"mb_per_s\":%.3f,\"elements_per_s\":%.1f}\n",
+					record.benchmark, asset, spec.glb ? "glb" : "gltf", spec.vertexCount, spec.nodeCount,
+					spec.accessorCount(), spec.glb ? 1 : spec.bufferCount, record.bytes, record.elements,
+					record.seconds, bench::megabytesPerSecond(record.bytes, record.seconds),
+					record.elements / record.seconds);
+	}
+
+	void writeFile(const std::filesystem::path &path, const void *data, size_t size)
+	{
+		std::ofstream(path, std::ios::binary).write(static_cast<const char *>(data), size);
+	}
+
+	std::vector<std::byte> readFile(const std::filesystem::path &path)
+	{
+		std::ifstream stream(path, std::ios::binary | std::ios::ate);
+		std::vector<std::byte> bytes(static_cast<size_t>(stream.tellg()));
+		stream.seekg(0);
+		stream.read(reinterpret_cast<char *>(bytes.data()), bytes.size());
+		return bytes;
+	}
+
+	std::optional<Model> parse(const std::string &path, const std::vector<std::byte> &bytes, bool glb)
+	{
+		if (!glb)
+		{
+			return loadStreaming(path, std::string_view(reinterpret_cast<const char *>(bytes.data()), bytes.size()));
+		}
+		const std::optional<GLBChunks> chunks = parseGLB(bytes);
+		return chunks.has_value() ? loadStreaming(path, chunks->json) : std::nullopt;
+	}
+
+	bool run(const char *name, const bench::AssetSpec &spec, int repetitions, const std::filesystem::path &directory)
+	{
+		const bench::Asset asset = bench::generateAsset(spec);
+		const std::filesystem::path path = directory / (spec.glb ? "asset.glb" : "asset.gltf");
+		std::vector<std::byte> container;
+		if (spec.glb)
+		{
+			container = bench::packGLB(asset);
+		}
+		else
+		{
+			container.assign(reinterpret_cast<const std::byte *>(asset.json.data()),
+							 reinterpret_cast<const std::byte *>(asset.json.data() + asset.json.size()));
+			for (size_t i = 0; i < asset.buffers.size(); ++i)
+			{
+				writeFile(directory / ("asset" + std::to_string(i) + ".bin"), asset.buffers[i].data(), asset.buffers[i].size());
+			}
+		}
+		writeFile(path, container.data(), container.size());
+
+		std::optional<Model> parsed = parse(path.string(), container, spec.glb);
+		if (!parsed.has_value())
+		{
+			std::fprintf(stderr, "generated %s asset failed to parse\n", name);
+			return false;
+		}
+		const Model &model = parsed.value();
+		const size_t modelElements = model.nodes.size() + model.accessors.size();
+
+		const double parseTime = bench::measure([&]() {
+			bench::doNotOptimize(parse(path.string(), container, spec.glb));
+		}, repetitions);
+		print(name, spec, {"parse", asset.json.size(), modelElements, parseTime});
+
+		// from disk: the buffer files, or the whole .glb whose BIN chunk is used in place
+		BufferSources sources;
+		const double loadTime = bench::measure([&]() {
+			sources.clear();
+			if (spec.glb)
+			{
+				auto bytes = std::make_shared<MemoryBufferSource>(readFile(path));
+				const std::optional<GLBChunks> chunks = parseGLB(bytes->data());
+				bench::doNotOptimize(chunks);
+				sources.push_back(bytes);
+			}
+			else
+			{
+				for (const Buffer &buffer : model.buffers)
+				{
+					sources.push_back(readBuffer(directory.string(), buffer).source);
+				}
+			}
+		}, repetitions);
+		print(name, spec, {"buffer_load", asset.bufferBytes(), model.buffers.size(), loadTime});
+
+		std::vector<ByteSpan> buffers;
+		if (spec.glb)
+		{
+			buffers.push_back(parseGLB(sources[0]->data())->bin);
+		}
+		else
+		{
+			for (const auto &source : sources)
+			{
+				buffers.push_back(source ? source->data() : ByteSpan());
+			}
+		}
+		const ModelAccessors accessors(model, buffers);
+
+		size_t vertexCount = 0, iterateBytes = 0, convertBytes = 0, convertElements = 0;
+		for (const Mesh &mesh : model.meshes)
+		{
+			for (const Primitive &primitive : mesh.primitives)
+			{
+				const Accessor &position = accessors.getAccessor(primitive, Attribute::POSITION);
+				vertexCount += position.count;
+				iterateBytes += position.count * 24ull;
+				for (const auto &[attribute, index] : primitive.attributes)
+				{
+					const Accessor &accessor = model.accessors[index];
+					convertBytes += accessor.count * elementSize(accessor.componentType, accessor.type);
+					convertElements += accessor.count;
+				}
+				const Accessor &indices = model.accessors[primitive.indices.value()];
+				convertBytes += indices.count * elementSize(indices.componentType, indices.type);
+				convertElements += indices.count;
+			}
+		}
+
+		// POSITION and NORMAL in place through TypedAccessor, summing every component
+		const double iterateTime = bench::measure([&]() {
+			float sum = 0;
+			for (const Mesh &mesh : model.meshes)
+			{
+				for (const Primitive &primitive : mesh.primitives)
+				{
+					for (Attribute attribute : {Attribute::POSITION, Attribute::NORMAL})
+					{
+						for (const float *value : accessors.getTypedAccessor<float, 3>(primitive, attribute))
+						{
+							sum += value[0] + value[1] + value[2];
+						}
+					}
+				}
+			}
+			bench::doNotOptimize(sum);
+		}, repetitions);
+		print(name, spec, {"iterate", iterateBytes, vertexCount * 2, iterateTime});
+
+		// every attribute to packed floats and the indices to 32 bits with readAccessor
+		std::vector<float> floats;
+		std::vector<uint32_t> indices;
+		const double convertTime = bench::measure([&]() {
+			for (const Mesh &mesh : model.meshes)
+			{
+				for (const Primitive &primitive : mesh.primitives)
+				{
+					for (const auto &[attribute, index] : primitive.attributes)
+					{
+						const Accessor &accessor = model.accessors[index];
+						floats.resize(accessor.count * componentCount(accessor.type));
+						accessors.readAccessor(accessor, std::span<float>(floats));
+					}
+					const Accessor &accessor = model.accessors[primitive.indices.value()];
+					indices.resize(accessor.count);
+					accessors.readAccessor(accessor, std::span<uint32_t>(indices));
+				}
+			}
+			bench::doNotOptimize(floats.data());
+			bench::doNotOptimize(indices.data());
+		}, repetitions);
+		print(name, spec, {"convert", convertBytes, convertElements, convertTime});
+		return true;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<Preset> selected;
+	bench::AssetSpec overrides{0, 0, 0, 0};
+	bool glb = false;
+	int repetitions = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		const size_t equals = argument.find('=');
+		const std::string key = argument.substr(0, equals);
+		const unsigned int value = equals == std::string::npos ? 0 : std::stoul(argument.substr(equals + 1));
+
+		if (argument == "--glb") glb = true;
+		else if (key == "--vertices") overrides.vertexCount = value;
+		else if (key == "--nodes") overrides.nodeCount = value;
+		else if (key == "--meshes") overrides.meshCount = value;
+		else if (key == "--buffers") overrides.bufferCount = value;
+		else if (key == "--repetitions") repetitions = static_cast<int>(value);
+		else
+		{
+			const Preset *preset = std::find_if(std::begin(presets), std::end(presets),
+												[&](const Preset &p) { return argument == p.name; });
+			if (preset == std::end(presets))
+			{
+				std::fprintf(stderr, "unknown argument %s\n", argv[i]);
+				return 1;
+			}
+			selected.push_back(*preset);
+		}
+	}
+
+	const bool bothFormats = selected.empty() && !glb;
+	if (selected.empty())
+	{
+		selected.assign(presets, presets + 2);
+	}
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "boiler-gltf-bench";
+	std::filesystem::create_directories(directory);
+
+	bool ok = true;
+	for (Preset preset : selected)
+	{
+		if (overrides.vertexCount) preset.spec.vertexCount = overrides.vertexCount;
+		if (overrides.nodeCount) preset.spec.nodeCount = overrides.nodeCount;
+		if (overrides.meshCount) preset.spec.meshCount = overrides.meshCount;
+		if (overrides.bufferCount) preset.spec.bufferCount = overrides.bufferCount;
+		if (repetitions) preset.repetitions = repetitions;
+
+		for (const bool asGLB : {false, true})
+		{
+			if (bothFormats || asGLB == glb)
+			{
+				preset.spec.glb = asGLB;
+				ok = run(preset.name, preset.spec, preset.repetitions, directory) && ok;
+			}
+		}
+	}
+
+	std::filesystem::remove_all(directory);
+	return ok ? 0 : 1;
+}
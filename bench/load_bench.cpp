@@ -0,0 +1,59 @@
+#include <cstring>
+#include "baked.h"
+#include "gltf.h"
+#include "benchutil.h"
+#include "synthetic.h"
+
+using namespace Boiler::gltf;
+
+int main()
+{
+	std::printf("%-8s %10s %12s %12s %8s %12s\n", "nodes", "json KB", "DOM MB/s", "SAX MB/s", "speedup", "baked ms");
+
+	for (const unsigned int nodeCount : {1000u, 10000u, 100000u})
+	{
+		bench::SceneSpec spec;
+		spec.nodeCount = nodeCount;
+		spec.meshCount = nodeCount / 10;
+		spec.materialCount = 32;
+		spec.animationCount = nodeCount / 100;
+		const std::string json = bench::generateSceneJson(spec);
+
+		const Model domModel = load("synthetic.gltf", json);
+		const std::optional<Model> saxModel = loadStreaming("synthetic.gltf", json);
+		if (!saxModel.has_value() || !(saxModel.value() == domModel))
+		{
+			std::fprintf(stderr, "streaming loader result differs from load() for %u nodes\n", nodeCount);
+			return 1;
+		}
+
+		// baked with empty buffers, so this times the model tables alone
+		const std::vector<std::byte> blob = bakeModel(domModel, {});
+		const auto bakedSource = std::make_shared<MemoryBufferSource>(blob);
+		const std::optional<BakedModel> baked = loadBaked(bakedSource);
+		if (!baked.has_value() || !(baked->model == domModel))
+		{
+			std::fprintf(stderr, "baked model differs from load() for %u nodes\n", nodeCount);
+			return 1;
+		}
+
+		const int repetitions = nodeCount < 100000 ? 20 : 5;
+		const double domTime = bench::measure([&]() {
+			bench::doNotOptimize(load("synthetic.gltf", json));
+		}, repetitions);
+		const double saxTime = bench::measure([&]() {
+			bench::doNotOptimize(loadStreaming("synthetic.gltf", json));
+		}, repetitions);
+
+		const double bakedTime = bench::measure([&]() {
+			bench::doNotOptimize(loadBaked(bakedSource));
+		}, repetitions);
+
+		std::printf("%-8u %10zu %12.1f %12.1f %7.2fx %12.2f\n", nodeCount, json.size() / 1024,
+					bench::megabytesPerSecond(json.size(), domTime),
+					bench::megabytesPerSecond(json.size(), saxTime),
+					domTime / saxTime, bakedTime * 1000);
+	}
+
+	return 0;
+}
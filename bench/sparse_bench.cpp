@@ -0,0 +1,129 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "gltf.h"
+#include "modelaccessors.h"
+#include "benchutil.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	// A VEC3 float accessor of elementCount elements with sparseCount of them
+	// replaced, all backed by a single buffer.
+	struct SparseScene
+	{
+		Model model;
+		std::vector<std::vector<std::byte>> buffers;
+
+		SparseScene(unsigned int elementCount, unsigned int sparseCount, unsigned int seed)
+			: model("sparse.gltf")
+		{
+			std::mt19937 random(seed);
+			const size_t baseBytes = elementCount * 12ull;
+			const size_t indexBytes = sparseCount * 4ull;
+			const size_t valueBytes = sparseCount * 12ull;
+
+			std::vector<std::byte> data(baseBytes + indexBytes + valueBytes);
+			std::vector<float> floats(elementCount * 3ull + sparseCount * 3ull);
+			for (auto &value : floats)
+			{
+				value = static_cast<float>(random() % 1000) / 10.0f;
+			}
+			std::memcpy(data.data(), floats.data(), baseBytes);
+			std::memcpy(data.data() + baseBytes + indexBytes, floats.data() + elementCount * 3ull, valueBytes);
+
+			// evenly spread, strictly increasing indices
+			for (unsigned int i = 0; i < sparseCount; ++i)
+			{
+				const uint32_t index = static_cast<uint32_t>(static_cast<uint64_t>(i) * elementCount / sparseCount);
+				std::memcpy(data.data() + baseBytes + i * 4ull, &index, sizeof(index));
+			}
+
+			model.buffers.push_back(Buffer(static_cast<byte_size>(data.size())));
+			for (const auto &[offset, length] : {std::pair{size_t(0), baseBytes}, {baseBytes, indexBytes},
+												 {baseBytes + indexBytes, valueBytes}})
+			{
+				BufferView bufferView;
+				bufferView.buffer = 0;
+				bufferView.byteOffset = static_cast<byte_size>(offset);
+				bufferView.byteLength = static_cast<byte_size>(length);
+				model.bufferViews.push_back(bufferView);
+			}
+
+			Accessor accessor;
+			accessor.bufferView = 0;
+			accessor.componentType = ComponentType::FLOAT;
+			accessor.type = AccessorType::VEC3;
+			accessor.count = elementCount;
+			accessor.sparse = Sparse();
+			accessor.sparse->count = sparseCount;
+			accessor.sparse->indices.bufferView = 1;
+			accessor.sparse->values.bufferView = 2;
+			model.accessors.push_back(accessor);
+
+			buffers.push_back(std::move(data));
+		}
+	};
+}
+
+int main()
+{
+	constexpr unsigned int elementCount = 1000000;
+	std::printf("%-9s %16s %16s %16s\n", "sparsity", "dense ns/elem", "overlay ns/elem", "lookup ns/elem");
+
+	for (const double ratio : {0.001, 0.01, 0.1, 0.5})
+	{
+		const unsigned int sparseCount = static_cast<unsigned int>(elementCount * ratio);
+		const SparseScene scene(elementCount, sparseCount, 7);
+		const ModelAccessors modelAccess(scene.model, scene.buffers);
+		const Accessor &accessor = scene.model.accessors[0];
+
+		std::vector<float> dense(elementCount * 3ull);
+		const double denseTime = bench::measure([&]() {
+			modelAccess.readAccessor<float>(accessor, dense);
+			bench::doNotOptimize(dense.data());
+		});
+
+		const auto overlay = modelAccess.getSparseAccessor<float, 3>(accessor);
+		size_t i = 0;
+		for (const float *element : overlay)
+		{
+			if (std::memcmp(element, &dense[i++ * 3], sizeof(float) * 3) != 0)
+			{
+				std::fprintf(stderr, "overlay differs from the dense view at element %zu\n", i - 1);
+				return 1;
+			}
+		}
+
+		const double overlayTime = bench::measure([&]() {
+			float sum = 0;
+			for (const float *element : overlay)
+			{
+				sum += element[0] + element[1] + element[2];
+			}
+			bench::doNotOptimize(sum);
+		});
+
+		std::mt19937 random(3);
+		std::vector<unsigned int> lookups(elementCount);
+		for (auto &lookup : lookups)
+		{
+			lookup = random() % elementCount;
+		}
+		const double lookupTime = bench::measure([&]() {
+			float sum = 0;
+			for (const unsigned int lookup : lookups)
+			{
+				sum += overlay[lookup][0];
+			}
+			bench::doNotOptimize(sum);
+		});
+
+		std::printf("%-9.3f %16.2f %16.2f %16.2f\n", ratio, denseTime * 1e9 / elementCount,
+					overlayTime * 1e9 / elementCount, lookupTime * 1e9 / elementCount);
+	}
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace Boiler { namespace gltf { namespace bench
+{
+	// Size of a generated scene. Every mesh has one primitive with position,
+	// normal and texcoord accessors plus indices.
+	struct SceneSpec
+	{
+		unsigned int nodeCount = 1000;
+		unsigned int meshCount = 100;
+		unsigned int materialCount = 10;
+		unsigned int animationCount = 10;
+		unsigned int seed = 1;
+	};
+
+	class JsonWriter
+	{
+		std::string json;
+		char scratch[64];
+
+	public:
+		JsonWriter &raw(const char *text) { json += text; return *this; }
+		JsonWriter &number(double value)
+		{
+			std::snprintf(scratch, sizeof(scratch), "%.9g", value);
+			json += scratch;
+			return *this;
+		}
+		JsonWriter &integer(unsigned long long value)
+		{
+			std::snprintf(scratch, sizeof(scratch), "%llu", value);
+			json += scratch;
+			return *this;
+		}
+		void comma(bool needed) { if (needed) json += ','; }
+		std::string take() { return std::move(json); }
+	};
+
+	// Builds a deterministic glTF document covering every part of the schema
+	// the loaders read. Buffers are referenced by uri but not generated.
+	inline std::string generateSceneJson(const SceneSpec &spec)
+	{
+		std::mt19937 random(spec.seed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		JsonWriter out;
+
+		out.raw("{\"asset\":{\"version\":\"2.0\",\"generator\":\"boiler-gltf synthetic\"},\"scene\":0,");
+		out.raw("\"scenes\":[{\"nodes\":[0]}],\"nodes\":[");
+		for (unsigned int i = 0; i < spec.nodeCount; ++i)
+		{
+			out.comma(i > 0);
+			out.raw("{\"name\":\"node_").integer(i).raw("\"");
+
+			// a binary tree keeps the hierarchy shallow but connected
+			const unsigned int left = 2 * i + 1, right = 2 * i + 2;
+			if (left < spec.nodeCount)
+			{
+				out.raw(",\"children\":[").integer(left);
+				if (right < spec.nodeCount) out.raw(",").integer(right);
+				out.raw("]");
+			}
+
+			if (i % 7 == 0)
+			{
+				out.raw(",\"matrix\":[");
+				for (int j = 0; j < 16; ++j)
+				{
+					out.comma(j > 0);
+					out.number(j % 5 == 0 ? 1.0 : 0.0);
+				}
+				out.raw("]");
+			}
+			else
+			{
+				out.raw(",\"translation\":[").number(unit(random)).raw(",").number(unit(random)).raw(",").number(unit(random)).raw("]");
+				out.raw(",\"rotation\":[0,0,0,1],\"scale\":[1,1,1]");
+			}
+			if (spec.meshCount > 0 && i % 3 == 0)
+			{
+				out.raw(",\"mesh\":").integer(i / 3 % spec.meshCount);
+				if (i % 2) out.raw(",\"skin\":0");
+			}
+			out.raw("}");
+		}
+
+		out.raw("],\"meshes\":[");
+		for (unsigned int i = 0; i < spec.meshCount; ++i)
+		{
+			const unsigned int first = i * 4;
+			out.comma(i > 0);
+			out.raw("{\"name\":\"mesh_").integer(i).raw("\",\"primitives\":[{\"attributes\":{");
+			out.raw("\"POSITION\":").integer(first).raw(",\"NORMAL\":").integer(first + 1);
+			out.raw(",\"TEXCOORD_0\":").integer(first + 2).raw("},\"indices\":").integer(first + 3);
+			if (spec.materialCount > 0)
+			{
+				out.raw(",\"material\":").integer(i % spec.materialCount);
+			}
+			if (i % 5 == 0)
+			{
+				// morph the positions by the sparse accessor after the meshes' own
+				out.raw(",\"targets\":[{\"POSITION\":").integer(spec.meshCount * 4).raw("}]");
+			}
+			out.raw(",\"mode\":4}]");
+			if (i % 5 == 0) out.raw(",\"weights\":[0.5]");
+			out.raw("}");
+		}
+
+		out.raw("],\"accessors\":[");
+		for (unsigned int i = 0; i < spec.meshCount; ++i)
+		{
+			const unsigned int view = i * 4;
+			out.comma(i > 0);
+			out.raw("{\"bufferView\":").integer(view).raw(",\"componentType\":5126,\"count\":24,\"type\":\"VEC3\",");
+			out.raw("\"min\":[-1,-1,-1],\"max\":[1,1,1]},");
+			out.raw("{\"bufferView\":").integer(view + 1).raw(",\"componentType\":5126,\"count\":24,\"type\":\"VEC3\"},");
+			out.raw("{\"bufferView\":").integer(view + 2).raw(",\"componentType\":5126,\"count\":24,\"type\":\"VEC2\",\"name\":\"uv\"},");
+			out.raw("{\"bufferView\":").integer(view + 3).raw(",\"byteOffset\":0,\"componentType\":5123,\"count\":36,\"type\":\"SCALAR\"}");
+		}
+		if (spec.meshCount > 0)
+		{
+			// a sparse morph-style accessor without base data
+			out.raw(",{\"componentType\":5126,\"count\":24,\"type\":\"VEC3\",\"sparse\":{\"count\":4,");
+			out.raw("\"indices\":{\"bufferView\":3,\"componentType\":5123},\"values\":{\"bufferView\":0,\"byteOffset\":12}}}");
+		}
+
+		out.raw("],\"bufferViews\":[");
+		for (unsigned int i = 0; i < spec.meshCount; ++i)
+		{
+			const unsigned long long base = i * 936ull;
+			out.comma(i > 0);
+			out.raw("{\"buffer\":0,\"byteOffset\":").integer(base).raw(",\"byteLength\":288,\"target\":34962},");
+			out.raw("{\"buffer\":0,\"byteOffset\":").integer(base + 288).raw(",\"byteLength\":288,\"byteStride\":12},");
+			out.raw("{\"buffer\":0,\"byteOffset\":").integer(base + 576).raw(",\"byteLength\":192},");
+			out.raw("{\"buffer\":0,\"byteOffset\":").integer(base + 768).raw(",\"byteLength\":72,\"target\":34963,\"name\":\"indices\"}");
+		}
+		out.raw("],\"buffers\":[{\"uri\":\"synthetic.bin\",\"byteLength\":").integer(spec.meshCount * 936ull).raw("}]");
+
+		out.raw(",\"materials\":[");
+		for (unsigned int i = 0; i < spec.materialCount; ++i)
+		{
+			out.comma(i > 0);
+			out.raw("{\"name\":\"material_").integer(i).raw("\",\"pbrMetallicRoughness\":{");
+			out.raw("\"baseColorFactor\":[").number(unit(random) * 0.5 + 0.5).raw(",0.5,0.5,1],");
+			out.raw("\"baseColorTexture\":{\"index\":0,\"texCoord\":0},\"metallicFactor\":0.25,\"roughnessFactor\":0.75},");
+			out.raw("\"normalTexture\":{\"index\":0,\"scale\":0.5},\"emissiveFactor\":[0,0,0]");
+			if (i % 2) out.raw(",\"alphaMode\":\"MASK\",\"alphaCutoff\":0.25,\"doubleSided\":true");
+			out.raw("}");
+		}
+
+		out.raw("],\"images\":[{\"uri\":\"texture.png\",\"mimeType\":\"image/png\"}]");
+		out.raw(",\"textures\":[{\"sampler\":0,\"source\":0,\"name\":\"texture\"}]");
+
+		out.raw(",\"animations\":[");
+		for (unsigned int i = 0; i < spec.animationCount; ++i)
+		{
+			out.comma(i > 0);
+			out.raw("{\"name\":\"animation_").integer(i).raw("\",\"samplers\":[");
+			out.raw("{\"input\":0,\"output\":0},{\"input\":0,\"output\":1,\"interpolation\":\"STEP\"}],\"channels\":[");
+			out.raw("{\"sampler\":0,\"target\":{\"node\":").integer(i % spec.nodeCount).raw(",\"path\":\"translation\"}},");
+			out.raw("{\"sampler\":1,\"target\":{\"node\":").integer(i % spec.nodeCount).raw(",\"path\":\"scale\"}}]}");
+		}
+		out.raw("],\"skins\":[{\"name\":\"skin\",\"skeleton\":0,\"joints\":[");
+		for (unsigned int i = 0; i < spec.nodeCount && i < 64; ++i)
+		{
+			out.comma(i > 0);
+			out.integer(i);
+		}
+		out.raw("]}],\"extensionsUsed\":[],\"extras\":{\"note\":[1,{\"nested\":true}]}}");
+
+		return out.take();
+	}
+}}}
+
+#endif /* SYNTHETIC_H */
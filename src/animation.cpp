@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cmath>
+#include "animation.h"
+#include "modelaccessors.h"
+#include "scenegraph.h"
+#include "simd.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	std::optional<AnimationPath> toAnimationPath(std::string_view path)
+	{
+		if (path == "translation") return AnimationPath::TRANSLATION;
+		if (path == "rotation") return AnimationPath::ROTATION;
+		if (path == "scale") return AnimationPath::SCALE;
+		if (path == "weights") return AnimationPath::WEIGHTS;
+		return std::nullopt;
+	}
+
+	// keyframe k of times with times[k] <= time < times[k + 1], for times
+	// strictly inside the first and last keyframes
+	size_t findKey(const float *times, size_t keyCount, float time, uint32_t cursor)
+	{
+		// playback usually moves forward by at most a keyframe or two
+		constexpr size_t maxSteps = 4;
+		size_t key = std::min<size_t>(cursor, keyCount - 2);
+		if (times[key] <= time)
+		{
+			for (size_t step = 0; step < maxSteps; ++step, ++key)
+			{
+				if (time < times[key + 1])
+				{
+					return key;
+				}
+			}
+		}
+		return std::upper_bound(times, times + keyCount, time) - times - 1;
+	}
+
+	// correction to the blend factor that makes nlerp track slerp closely,
+	// as a function of the cosine of the angle between the quaternions
+	inline float slerpFactor(float t, float cosine)
+	{
+		const float a = 1.0904f + cosine * (-3.2452f + cosine * (3.55645f - cosine * 1.43519f));
+		const float b = 0.848013f + cosine * (-1.06021f + cosine * 0.215638f);
+		const float k = a * (t - 0.5f) * (t - 0.5f) + b;
+		return t + t * (t - 0.5f) * (t - 1) * k;
+	}
+
+	void blendQuaternion(AnimationState::QuaternionBatch &batch, size_t i, QuaternionBlend blend)
+	{
+		float dot = batch.ax[i] * batch.bx[i] + batch.ay[i] * batch.by[i]
+			+ batch.az[i] * batch.bz[i] + batch.aw[i] * batch.bw[i];
+		// q and -q are the same rotation; take the shorter way round
+		const float sign = dot < 0 ? -1.0f : 1.0f;
+		dot = std::fabs(dot);
+		const float t = blend == QuaternionBlend::SLERP ? slerpFactor(batch.t[i], dot) : batch.t[i];
+
+		const float a = 1 - t, b = t * sign;
+		const float x = batch.ax[i] * a + batch.bx[i] * b;
+		const float y = batch.ay[i] * a + batch.by[i] * b;
+		const float z = batch.az[i] * a + batch.bz[i] * b;
+		const float w = batch.aw[i] * a + batch.bw[i] * b;
+		const float scale = 1 / std::sqrt(x * x + y * y + z * z + w * w);
+		batch.ax[i] = x * scale;
+		batch.ay[i] = y * scale;
+		batch.az[i] = z * scale;
+		batch.aw[i] = w * scale;
+	}
+
+	inline void normalize4(float *q)
+	{
+		const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		if (length > 0)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				q[c] /= length;
+			}
+		}
+	}
+}
+
+void AnimationState::QuaternionBatch::clear()
+{
+	for (auto *component : {&ax, &ay, &az, &aw, &bx, &by, &bz, &bw, &t})
+	{
+		component->clear();
+	}
+	result.clear();
+}
+
+void AnimationState::QuaternionBatch::push(const float *a, const float *b, float factor, size_t resultOffset)
+{
+	ax.push_back(a[0]); ay.push_back(a[1]); az.push_back(a[2]); aw.push_back(a[3]);
+	bx.push_back(b[0]); by.push_back(b[1]); bz.push_back(b[2]); bw.push_back(b[3]);
+	t.push_back(factor);
+	result.push_back(resultOffset);
+}
+
+void Boiler::gltf::blendQuaternions(AnimationState::QuaternionBatch &batch, QuaternionBlend blend)
+{
+	const size_t count = batch.t.size();
+	size_t i = 0;
+#if defined(BOILER_GLTF_X86) && (defined(__SSE__) || defined(_M_X64))
+	// four pairs at a time, the same arithmetic as blendQuaternion
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const bool slerp = blend == QuaternionBlend::SLERP;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 ax = _mm_loadu_ps(&batch.ax[i]), ay = _mm_loadu_ps(&batch.ay[i]);
+		const __m128 az = _mm_loadu_ps(&batch.az[i]), aw = _mm_loadu_ps(&batch.aw[i]);
+		const __m128 bx = _mm_loadu_ps(&batch.bx[i]), by = _mm_loadu_ps(&batch.by[i]);
+		const __m128 bz = _mm_loadu_ps(&batch.bz[i]), bw = _mm_loadu_ps(&batch.bw[i]);
+		__m128 t = _mm_loadu_ps(&batch.t[i]);
+
+		__m128 dot = _mm_mul_ps(ax, bx);
+		dot = _mm_add_ps(dot, _mm_mul_ps(ay, by));
+		dot = _mm_add_ps(dot, _mm_mul_ps(az, bz));
+		dot = _mm_add_ps(dot, _mm_mul_ps(aw, bw));
+		const __m128 sign = _mm_and_ps(dot, signMask);
+		dot = _mm_andnot_ps(signMask, dot);
+
+		if (slerp)
+		{
+			__m128 a = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(dot, _mm_set1_ps(1.43519f)));
+			a = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(dot, a));
+			a = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(dot, a));
+			__m128 b = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(dot, _mm_set1_ps(0.215638f)));
+			b = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(dot, b));
+			const __m128 centered = _mm_sub_ps(t, half);
+			const __m128 k = _mm_add_ps(_mm_mul_ps(a, _mm_mul_ps(centered, centered)), b);
+			const __m128 bend = _mm_mul_ps(_mm_mul_ps(t, centered), _mm_sub_ps(t, one));
+			t = _mm_add_ps(t, _mm_mul_ps(bend, k));
+		}
+
+		const __m128 a = _mm_sub_ps(one, t);
+		const __m128 b = _mm_xor_ps(t, sign);
+		const __m128 x = _mm_add_ps(_mm_mul_ps(ax, a), _mm_mul_ps(bx, b));
+		const __m128 y = _mm_add_ps(_mm_mul_ps(ay, a), _mm_mul_ps(by, b));
+		const __m128 z = _mm_add_ps(_mm_mul_ps(az, a), _mm_mul_ps(bz, b));
+		const __m128 w = _mm_add_ps(_mm_mul_ps(aw, a), _mm_mul_ps(bw, b));
+		__m128 length = _mm_mul_ps(x, x);
+		length = _mm_add_ps(length, _mm_mul_ps(y, y));
+		length = _mm_add_ps(length, _mm_mul_ps(z, z));
+		length = _mm_add_ps(length, _mm_mul_ps(w, w));
+		length = _mm_sqrt_ps(length);
+
+		_mm_storeu_ps(&batch.ax[i], _mm_div_ps(x, length));
+		_mm_storeu_ps(&batch.ay[i], _mm_div_ps(y, length));
+		_mm_storeu_ps(&batch.az[i], _mm_div_ps(z, length));
+		_mm_storeu_ps(&batch.aw[i], _mm_div_ps(w, length));
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		blendQuaternion(batch, i, blend);
+	}
+}
+
+std::optional<AnimationClip> AnimationClip::resolve(const ModelAccessors &accessors, const Animation &animation)
+{
+	const Model &model = accessors.getModel();
+	AnimationClip clip;
+
+	// samplers are converted once however many channels share them
+	struct ResolvedSampler
+	{
+		size_t times, values, keyCount;
+		unsigned int components;
+	};
+	std::vector<ResolvedSampler> samplers;
+	samplers.reserve(animation.samplers.size());
+	for (const Sampler &sampler : animation.samplers)
+	{
+		if (sampler.input >= model.accessors.size() || sampler.output >= model.accessors.size())
+		{
+			return std::nullopt;
+		}
+		const Accessor &input = model.accessors[sampler.input];
+		const Accessor &output = model.accessors[sampler.output];
+		const size_t keyCount = input.count;
+		const size_t valuesPerKey = sampler.interpolation == Interpolation::CUBICSPLINE ? 3 : 1;
+		const size_t outputFloats = static_cast<size_t>(output.count) * componentCount(output.type);
+		if (input.type != AccessorType::SCALAR || keyCount == 0 || outputFloats == 0
+			|| outputFloats % (keyCount * valuesPerKey) != 0)
+		{
+			return std::nullopt;
+		}
+
+		ResolvedSampler resolved{clip.times.size(), clip.values.size(), keyCount,
+								 static_cast<unsigned int>(outputFloats / (keyCount * valuesPerKey))};
+		clip.times.resize(resolved.times + keyCount);
+		clip.values.resize(resolved.values + outputFloats);
+		if (!accessors.readAccessor(input, std::span<float>(clip.times).subspan(resolved.times))
+			|| !accessors.readAccessor(output, std::span<float>(clip.values).subspan(resolved.values)))
+		{
+			return std::nullopt;
+		}
+		clip.lastTime = std::max(clip.lastTime, clip.times[resolved.times + keyCount - 1]);
+		samplers.push_back(resolved);
+	}
+
+	for (const Channel &channel : animation.channels)
+	{
+		const std::optional<AnimationPath> path = toAnimationPath(channel.target.path);
+		if (!channel.target.node.has_value() || !path.has_value())
+		{
+			continue;
+		}
+		if (channel.sampler >= samplers.size())
+		{
+			return std::nullopt;
+		}
+
+		const ResolvedSampler &sampler = samplers[channel.sampler];
+		const unsigned int expected = path == AnimationPath::ROTATION ? 4 : 3;
+		if (path != AnimationPath::WEIGHTS && sampler.components != expected)
+		{
+			return std::nullopt;
+		}
+
+		clip.trackTable.push_back({channel.target.node.value(), path.value(),
+								   animation.samplers[channel.sampler].interpolation, sampler.components,
+								   sampler.keyCount, sampler.times, sampler.values, clip.resultFloats});
+		clip.resultFloats += sampler.components;
+	}
+	return clip;
+}
+
+bool AnimationClip::sample(float time, AnimationState &state, std::span<float> result, QuaternionBlend blend) const
+{
+	if (result.size() < resultFloats)
+	{
+		return false;
+	}
+	state.cursors.resize(trackTable.size());
+	state.rotations.clear();
+
+	for (size_t i = 0; i < trackTable.size(); ++i)
+	{
+		const Track &track = trackTable[i];
+		const float *keyTimes = times.data() + track.times;
+		const float *keyValues = values.data() + track.values;
+		float *out = result.data() + track.result;
+		const unsigned int components = track.components;
+		const bool cubic = track.interpolation == Interpolation::CUBICSPLINE;
+		// cubic spline keyframes are in-tangent, value, out-tangent
+		const size_t keySize = cubic ? components * 3 : components;
+		const size_t valueOffset = cubic ? components : 0;
+
+		if (track.keyCount == 1 || time <= keyTimes[0])
+		{
+			std::copy_n(keyValues + valueOffset, components, out);
+			continue;
+		}
+		if (time >= keyTimes[track.keyCount - 1])
+		{
+			std::copy_n(keyValues + (track.keyCount - 1) * keySize + valueOffset, components, out);
+			continue;
+		}
+
+		const size_t key = findKey(keyTimes, track.keyCount, time, state.cursors[i]);
+		state.cursors[i] = static_cast<uint32_t>(key);
+		const float *from = keyValues + key * keySize;
+		const float *to = from + keySize;
+		const float duration = keyTimes[key + 1] - keyTimes[key];
+		const float t = (time - keyTimes[key]) / duration;
+
+		switch (track.interpolation)
+		{
+			case Interpolation::STEP:
+				std::copy_n(from, components, out);
+				break;
+
+			case Interpolation::LINEAR:
+				if (track.path == AnimationPath::ROTATION)
+				{
+					state.rotations.push(from, to, t, track.result);
+				}
+				else
+				{
+					for (unsigned int c = 0; c < components; ++c)
+					{
+						out[c] = from[c] + (to[c] - from[c]) * t;
+					}
+				}
+				break;
+
+			case Interpolation::CUBICSPLINE:
+			{
+				// Hermite basis with tangents scaled by the keyframe interval
+				const float t2 = t * t, t3 = t2 * t;
+				const float fromValue = 2 * t3 - 3 * t2 + 1;
+				const float fromTangent = (t3 - 2 * t2 + t) * duration;
+				const float toValue = -2 * t3 + 3 * t2;
+				const float toTangent = (t3 - t2) * duration;
+				for (unsigned int c = 0; c < components; ++c)
+				{
+					out[c] = fromValue * from[components + c] + fromTangent * from[2 * components + c]
+						+ toValue * to[components + c] + toTangent * to[c];
+				}
+				if (track.path == AnimationPath::ROTATION)
+				{
+					normalize4(out);
+				}
+				break;
+			}
+		}
+	}
+
+	AnimationState::QuaternionBatch &rotations = state.rotations;
+	blendQuaternions(rotations, blend);
+	for (size_t i = 0; i < rotations.result.size(); ++i)
+	{
+		float *out = result.data() + rotations.result[i];
+		out[0] = rotations.ax[i];
+		out[1] = rotations.ay[i];
+		out[2] = rotations.az[i];
+		out[3] = rotations.aw[i];
+	}
+	return true;
+}
+
+void AnimationClip::apply(std::span<const float> result, SceneGraph &scene) const
+{
+	for (const Track &track : trackTable)
+	{
+		const std::optional<size_t> entry = scene.find(static_cast<int>(track.node));
+		if (!entry.has_value() || track.result + track.components > result.size())
+		{
+			continue;
+		}
+
+		const float *value = result.data() + track.result;
+		switch (track.path)
+		{
+			case AnimationPath::TRANSLATION: scene.setTranslation(*entry, {value[0], value[1], value[2]}); break;
+			case AnimationPath::ROTATION: scene.setRotation(*entry, {value[0], value[1], value[2], value[3]}); break;
+			case AnimationPath::SCALE: scene.setScale(*entry, {value[0], value[1], value[2]}); break;
+			case AnimationPath::WEIGHTS: break;
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "gltf.h"
+
+namespace Boiler { namespace gltf
+{
+	class ModelAccessors;
+	class SceneGraph;
+
+	enum class AnimationPath
+	{
+		TRANSLATION,
+		ROTATION,
+		SCALE,
+		WEIGHTS
+	};
+
+	enum class QuaternionBlend
+	{
+		// nlerp with a correction to its timing that keeps it within a
+		// fraction of a degree of a true slerp
+		SLERP,
+		// plain normalized lerp: cheaper, but not constant angular velocity
+		NLERP
+	};
+
+	// Per-instance playback state for an AnimationClip. Each channel keeps the
+	// keyframe it last sampled, so playback that moves forward a little at a
+	// time finds the next keyframe in O(1) instead of searching for it.
+	struct AnimationState
+	{
+		std::vector<uint32_t> cursors;
+
+		// rotations to blend this sample, one array per component
+		struct QuaternionBatch
+		{
+			std::vector<float> ax, ay, az, aw;
+			std::vector<float> bx, by, bz, bw;
+			std::vector<float> t;
+			std::vector<size_t> result;
+
+			void clear();
+			void push(const float *a, const float *b, float t, size_t result);
+		} rotations;
+	};
+
+	// An animation with every sampler's keyframe times and values converted to
+	// packed floats up front, so sampling never touches accessors. Clips are
+	// immutable and can be shared by any number of instances, each sampling
+	// with its own AnimationState.
+	class AnimationClip
+	{
+	public:
+		struct Track
+		{
+			unsigned int node;
+			AnimationPath path;
+			Interpolation interpolation;
+			// floats per keyframe value: 3, 4 or the number of morph targets
+			unsigned int components;
+			size_t keyCount;
+			// offsets into the clip's times and values
+			size_t times;
+			size_t values;
+			// offset of this track's components in sample's result
+			size_t result;
+		};
+
+	private:
+		std::vector<Track> trackTable;
+		std::vector<float> times;
+		std::vector<float> values;
+		size_t resultFloats = 0;
+		float lastTime = 0;
+
+	public:
+		// Resolves the animation's channels, skipping channels without a target
+		// node or with a path this doesn't know. Returns nullopt if a channel
+		// refers to a missing sampler or a sampler's accessors don't match.
+		static std::optional<AnimationClip> resolve(const ModelAccessors &accessors, const Animation &animation);
+
+		std::span<const Track> tracks() const { return trackTable; }
+		// time of the last keyframe of any channel
+		float duration() const { return lastTime; }
+		// floats written by sample
+		size_t resultSize() const { return resultFloats; }
+
+		// Samples every track at time, clamping to the first and last
+		// keyframes, and writes each track's value to result + track.result.
+		// Rotations are blended in one batch after the other tracks. Returns
+		// false if result is smaller than resultSize().
+		bool sample(float time, AnimationState &state, std::span<float> result,
+					QuaternionBlend blend = QuaternionBlend::SLERP) const;
+
+		// Sets the sampled translations, rotations and scales on the scene's
+		// nodes. Weights are left to the caller.
+		void apply(std::span<const float> result, SceneGraph &scene) const;
+	};
+
+	// Blends every pair of quaternions in the batch by its t, writing the
+	// normalized results over a.
+	void blendQuaternions(AnimationState::QuaternionBatch &batch, QuaternionBlend blend);
+}}
+
+#endif /* ANIMATION_H */
@@ -0,0 +1,692 @@
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include "baked.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	constexpr uint32_t MAGIC = 0x4B424C42; // "BLBK"
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t fileSize;
+		uint64_t sourceHash;
+		uint64_t tablesOffset;
+		uint64_t tablesSize;
+		uint64_t tablesHash;
+		// covers the buffer directory and every buffer's bytes
+		uint64_t dataHash;
+		uint64_t bufferCount;
+	};
+	static_assert(sizeof(Header) == 64 && std::is_trivially_copyable_v<Header>);
+
+	// where each buffer is, after the header
+	struct BufferEntry
+	{
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	size_t alignUp(size_t value)
+	{
+		return (value + BAKED_ALIGNMENT - 1) & ~(BAKED_ALIGNMENT - 1);
+	}
+
+	// Appends fields as fixed-width little-endian values. Strings are a
+	// length followed by their bytes, vectors a count followed by elements.
+	class BakeWriter
+	{
+		std::vector<std::byte> &out;
+
+	public:
+		explicit BakeWriter(std::vector<std::byte> &out) : out(out) {}
+
+		template<typename T>
+		void raw(const T &value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			const size_t offset = out.size();
+			out.resize(offset + sizeof(T));
+			std::memcpy(out.data() + offset, &value, sizeof(T));
+		}
+
+		void write(uint32_t value) { raw(value); }
+		void write(int value) { raw(static_cast<int32_t>(value)); }
+		void write(float value) { raw(value); }
+		void write(bool value) { raw(static_cast<uint8_t>(value)); }
+		void write(ComponentType value) { raw(static_cast<uint32_t>(value)); }
+		void write(AccessorType value) { raw(static_cast<uint32_t>(value)); }
+		void write(Interpolation value) { raw(static_cast<uint32_t>(value)); }
+		void write(const AccessorValue &value) { raw(value.asUnsignedInt); }
+		template<size_t Size>
+		void write(const std::array<float, Size> &value) { raw(value); }
+
+		void write(std::string_view value)
+		{
+			write(static_cast<uint32_t>(value.size()));
+			const size_t offset = out.size();
+			out.resize(offset + value.size());
+			std::memcpy(out.data() + offset, value.data(), value.size());
+		}
+
+		template<typename T>
+		void write(const std::optional<T> &value)
+		{
+			write(value.has_value());
+			if (value.has_value())
+			{
+				write(*value);
+			}
+		}
+
+		template<typename T>
+		void write(const std::vector<T> &values)
+		{
+			write(static_cast<uint32_t>(values.size()));
+			for (const T &value : values)
+			{
+				write(value);
+			}
+		}
+
+		void write(const Attributes &attributes)
+		{
+			for (size_t i = 0; i < static_cast<size_t>(Attribute::ATTRIBUTE_COUNT); ++i)
+			{
+				write(attributes.find(static_cast<Attribute>(i)).value_or(-1));
+			}
+			write(static_cast<uint32_t>(attributes.customAttributes().size()));
+			for (const auto &[name, accessor] : attributes.customAttributes())
+			{
+				write(name);
+				write(accessor);
+			}
+		}
+
+		void write(const Sparse &sparse)
+		{
+			write(sparse.count);
+			write(sparse.indices.bufferView);
+			write(sparse.indices.byteOffset);
+			write(sparse.indices.componentType);
+			write(sparse.values.bufferView);
+			write(sparse.values.byteOffset);
+		}
+
+		void write(const Accessor &accessor)
+		{
+			write(accessor.bufferView);
+			write(accessor.byteOffset);
+			write(accessor.componentType);
+			write(accessor.normalized);
+			write(accessor.count);
+			write(accessor.type);
+			write(accessor.max);
+			write(accessor.min);
+			write(accessor.sparse);
+			write(accessor.name);
+		}
+
+		void write(const BufferView &bufferView)
+		{
+			write(bufferView.buffer);
+			write(bufferView.byteOffset);
+			write(bufferView.byteLength);
+			write(bufferView.byteStride);
+			write(bufferView.target);
+			write(bufferView.name);
+		}
+
+		void write(const Buffer &buffer)
+		{
+			write(buffer.uri);
+			write(buffer.byteLength);
+			write(buffer.name);
+		}
+
+		void write(const Node &node)
+		{
+			write(node.children);
+			write(node.matrix);
+			write(node.mesh);
+			write(node.skin);
+			write(node.rotation);
+			write(node.scale);
+			write(node.translation);
+			write(node.name);
+		}
+
+		void write(const Scene &scene)
+		{
+			write(scene.nodes);
+		}
+
+		void write(const Primitive &primitive)
+		{
+			write(primitive.attributes);
+			write(primitive.targets);
+			write(primitive.indices);
+			write(primitive.material);
+			write(primitive.mode);
+		}
+
+		void write(const Mesh &mesh)
+		{
+			write(mesh.name);
+			write(mesh.primitives);
+			write(mesh.weights);
+		}
+
+		void write(const Image &image)
+		{
+			write(image.uri);
+			write(image.mimeType);
+			write(image.bufferView);
+			write(image.name);
+		}
+
+		void write(const Texture &texture)
+		{
+			write(texture.sampler);
+			write(texture.source);
+			write(texture.name);
+		}
+
+		void write(const MaterialTexture &texture)
+		{
+			write(texture.index);
+			write(texture.texCoord);
+			write(texture.scale);
+		}
+
+		void write(const PBRMetallicRoughness &pbr)
+		{
+			write(pbr.baseColorFactor);
+			write(pbr.baseColorTexture);
+			write(pbr.metallicFactor);
+			write(pbr.roughnessFactor);
+			write(pbr.metallicRoughnessTexture);
+		}
+
+		void write(const Material &material)
+		{
+			write(material.name);
+			write(material.pbrMetallicRoughness);
+			write(material.normalTexture);
+			write(material.occlusionTexture);
+			write(material.emissiveTexture);
+			write(material.emissiveFactor);
+			write(material.alphaMode);
+			write(material.alphaCutoff);
+			write(material.doubleSided);
+		}
+
+		void write(const Sampler &sampler)
+		{
+			write(sampler.input);
+			write(sampler.output);
+			write(sampler.interpolation);
+		}
+
+		void write(const Channel &channel)
+		{
+			write(channel.sampler);
+			write(channel.target.node);
+			write(channel.target.path);
+		}
+
+		void write(const Animation &animation)
+		{
+			write(animation.name);
+			write(animation.channels);
+			write(animation.samplers);
+		}
+
+		void write(const Skin &skin)
+		{
+			write(skin.inverseBindMatrices);
+			write(skin.skeleton);
+			write(skin.joints);
+			write(skin.name);
+		}
+
+		void write(const Model &model)
+		{
+			write(std::string_view(model.gltfPath));
+			write(model.asset.version);
+			write(model.asset.generator);
+			write(model.asset.copyright);
+			write(model.scene);
+			write(model.scenes);
+			write(model.nodes);
+			write(model.meshes);
+			write(model.buffers);
+			write(model.bufferViews);
+			write(model.accessors);
+			write(model.materials);
+			write(model.images);
+			write(model.textures);
+			write(model.animations);
+			write(model.skins);
+		}
+	};
+
+	// The inverse of BakeWriter. Any read past the end of the tables fails the
+	// whole load rather than producing a partial model.
+	class BakeReader
+	{
+		ByteSpan data;
+		size_t position = 0;
+		bool failed = false;
+
+		template<typename T>
+		T raw()
+		{
+			T value{};
+			if (failed || data.size() - position < sizeof(T))
+			{
+				failed = true;
+				return value;
+			}
+			std::memcpy(&value, data.data() + position, sizeof(T));
+			position += sizeof(T);
+			return value;
+		}
+
+		// a corrupt count can't claim more elements than there are bytes left
+		uint32_t count()
+		{
+			const uint32_t value = raw<uint32_t>();
+			if (value > data.size() - position)
+			{
+				failed = true;
+				return 0;
+			}
+			return value;
+		}
+
+	public:
+		explicit BakeReader(ByteSpan data) : data(data) {}
+
+		bool ok() const { return !failed; }
+
+		void read(unsigned int &value) { value = raw<uint32_t>(); }
+		void read(int &value) { value = raw<int32_t>(); }
+		void read(float &value) { value = raw<float>(); }
+		void read(bool &value) { value = raw<uint8_t>() != 0; }
+		void read(ComponentType &value) { value = static_cast<ComponentType>(raw<uint32_t>()); }
+		void read(AccessorType &value) { value = static_cast<AccessorType>(raw<uint32_t>()); }
+		void read(Interpolation &value) { value = static_cast<Interpolation>(raw<uint32_t>()); }
+		void read(AccessorValue &value) { value.asUnsignedInt = raw<uint32_t>(); }
+		template<size_t Size>
+		void read(std::array<float, Size> &value) { value = raw<std::array<float, Size>>(); }
+
+		void read(std::string_view &value)
+		{
+			const uint32_t length = count();
+			value = std::string_view(reinterpret_cast<const char *>(data.data() + position), failed ? 0 : length);
+			position += value.size();
+		}
+
+		template<typename T>
+		void read(std::optional<T> &value)
+		{
+			bool present = false;
+			read(present);
+			if (present)
+			{
+				read(value.emplace());
+			}
+			else
+			{
+				value.reset();
+			}
+		}
+
+		template<typename T>
+		void read(std::vector<T> &values)
+		{
+			const uint32_t size = count();
+			values.clear();
+			values.reserve(size);
+			for (uint32_t i = 0; i < size && ok(); ++i)
+			{
+				read(values.emplace_back(readElement(std::type_identity<T>())));
+			}
+		}
+
+		// vector elements that can't be default constructed are built here
+		template<typename T>
+		T readElement(std::type_identity<T>) { return T(); }
+		Buffer readElement(std::type_identity<Buffer>) { return Buffer(0); }
+		Sampler readElement(std::type_identity<Sampler>) { return Sampler(0, 0, Interpolation::LINEAR); }
+		AccessorValue readElement(std::type_identity<AccessorValue>) { return AccessorValue(0.0f); }
+
+		Channel readElement(std::type_identity<Channel>)
+		{
+			unsigned int sampler = 0;
+			Target target;
+			read(sampler);
+			read(target.node);
+			read(target.path);
+			return Channel(sampler, target);
+		}
+
+		void read(Attributes &attributes)
+		{
+			attributes = Attributes();
+			for (size_t i = 0; i < static_cast<size_t>(Attribute::ATTRIBUTE_COUNT); ++i)
+			{
+				int accessor = -1;
+				read(accessor);
+				if (accessor >= 0)
+				{
+					attributes.set(static_cast<Attribute>(i), accessor);
+				}
+			}
+			const uint32_t size = count();
+			for (uint32_t i = 0; i < size && ok(); ++i)
+			{
+				// names are views into the blob, which the model keeps alive
+				std::string_view name;
+				int accessor = 0;
+				read(name);
+				read(accessor);
+				attributes.set(name, accessor);
+			}
+		}
+
+		void read(Sparse &sparse)
+		{
+			read(sparse.count);
+			read(sparse.indices.bufferView);
+			read(sparse.indices.byteOffset);
+			read(sparse.indices.componentType);
+			read(sparse.values.bufferView);
+			read(sparse.values.byteOffset);
+		}
+
+		void read(Accessor &accessor)
+		{
+			read(accessor.bufferView);
+			read(accessor.byteOffset);
+			read(accessor.componentType);
+			read(accessor.normalized);
+			read(accessor.count);
+			read(accessor.type);
+			read(accessor.max);
+			read(accessor.min);
+			read(accessor.sparse);
+			read(accessor.name);
+		}
+
+		void read(BufferView &bufferView)
+		{
+			read(bufferView.buffer);
+			read(bufferView.byteOffset);
+			read(bufferView.byteLength);
+			read(bufferView.byteStride);
+			read(bufferView.target);
+			read(bufferView.name);
+		}
+
+		void read(Buffer &buffer)
+		{
+			read(buffer.uri);
+			read(buffer.byteLength);
+			read(buffer.name);
+		}
+
+		void read(Node &node)
+		{
+			read(node.children);
+			read(node.matrix);
+			read(node.mesh);
+			read(node.skin);
+			read(node.rotation);
+			read(node.scale);
+			read(node.translation);
+			read(node.name);
+		}
+
+		void read(Scene &scene)
+		{
+			read(scene.nodes);
+		}
+
+		void read(Primitive &primitive)
+		{
+			read(primitive.attributes);
+			read(primitive.targets);
+			read(primitive.indices);
+			read(primitive.material);
+			read(primitive.mode);
+		}
+
+		void read(Mesh &mesh)
+		{
+			read(mesh.name);
+			read(mesh.primitives);
+			read(mesh.weights);
+		}
+
+		void read(Image &image)
+		{
+			read(image.uri);
+			read(image.mimeType);
+			read(image.bufferView);
+			read(image.name);
+		}
+
+		void read(Texture &texture)
+		{
+			read(texture.sampler);
+			read(texture.source);
+			read(texture.name);
+		}
+
+		void read(MaterialTexture &texture)
+		{
+			read(texture.index);
+			read(texture.texCoord);
+			read(texture.scale);
+		}
+
+		void read(PBRMetallicRoughness &pbr)
+		{
+			read(pbr.baseColorFactor);
+			read(pbr.baseColorTexture);
+			read(pbr.metallicFactor);
+			read(pbr.roughnessFactor);
+			read(pbr.metallicRoughnessTexture);
+		}
+
+		void read(Material &material)
+		{
+			read(material.name);
+			read(material.pbrMetallicRoughness);
+			read(material.normalTexture);
+			read(material.occlusionTexture);
+			read(material.emissiveTexture);
+			read(material.emissiveFactor);
+			read(material.alphaMode);
+			read(material.alphaCutoff);
+			read(material.doubleSided);
+		}
+
+		void read(Sampler &sampler)
+		{
+			read(sampler.input);
+			read(sampler.output);
+			read(sampler.interpolation);
+		}
+
+		// a channel's target is const, so it's read whole by readElement
+		void read(Channel &)
+		{
+		}
+
+		void read(Animation &animation)
+		{
+			read(animation.name);
+			read(animation.channels);
+			read(animation.samplers);
+		}
+
+		void read(Skin &skin)
+		{
+			read(skin.inverseBindMatrices);
+			read(skin.skeleton);
+			read(skin.joints);
+			read(skin.name);
+		}
+
+		// everything after the path, which the caller needs to construct model
+		void read(Model &model)
+		{
+			read(model.asset.version);
+			read(model.asset.generator);
+			read(model.asset.copyright);
+			read(model.scene);
+			read(model.scenes);
+			read(model.nodes);
+			read(model.meshes);
+			read(model.buffers);
+			read(model.bufferViews);
+			read(model.accessors);
+			read(model.materials);
+			read(model.images);
+			read(model.textures);
+			read(model.animations);
+			read(model.skins);
+		}
+	};
+}
+
+uint64_t Boiler::gltf::hashBytes(ByteSpan data, uint64_t hash)
+{
+	constexpr uint64_t prime = 0x100000001b3ull;
+	size_t i = 0;
+	for (; i + 8 <= data.size(); i += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, data.data() + i, 8);
+		hash = (hash ^ word) * prime;
+		// fold the high bits back down so every input bit reaches the low ones
+		hash ^= hash >> 32;
+	}
+	for (; i < data.size(); ++i)
+	{
+		hash = (hash ^ static_cast<uint64_t>(data[i])) * prime;
+	}
+	return hash;
+}
+
+std::vector<std::byte> Boiler::gltf::bakeModel(const Model &model, const std::vector<ByteSpan> &buffers, uint64_t sourceHash)
+{
+	Header header{};
+	header.magic = MAGIC;
+	header.version = BAKED_VERSION;
+	header.sourceHash = sourceHash;
+	header.bufferCount = model.buffers.size();
+
+	std::vector<std::byte> blob(sizeof(Header) + header.bufferCount * sizeof(BufferEntry));
+	header.tablesOffset = blob.size();
+	BakeWriter(blob).write(model);
+	header.tablesSize = blob.size() - header.tablesOffset;
+
+	std::vector<BufferEntry> entries(header.bufferCount);
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const ByteSpan bytes = i < buffers.size() ? buffers[i] : ByteSpan();
+		entries[i] = {alignUp(blob.size()), bytes.size()};
+		blob.resize(entries[i].offset + bytes.size());
+		std::memcpy(blob.data() + entries[i].offset, bytes.data(), bytes.size());
+	}
+	std::memcpy(blob.data() + sizeof(Header), entries.data(), entries.size() * sizeof(BufferEntry));
+
+	const ByteSpan all(blob);
+	header.fileSize = blob.size();
+	header.tablesHash = hashBytes(all.subspan(header.tablesOffset, header.tablesSize));
+	header.dataHash = hashBytes(all.subspan(header.tablesOffset + header.tablesSize),
+								hashBytes(all.subspan(sizeof(Header), entries.size() * sizeof(BufferEntry))));
+	std::memcpy(blob.data(), &header, sizeof(Header));
+	return blob;
+}
+
+bool Boiler::gltf::writeBakedModel(const std::string &path, const Model &model, const std::vector<ByteSpan> &buffers,
+								   uint64_t sourceHash)
+{
+	const std::vector<std::byte> blob = bakeModel(model, buffers, sourceHash);
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char *>(blob.data()), blob.size());
+	return static_cast<bool>(file);
+}
+
+std::optional<BakedModel> Boiler::gltf::loadBaked(std::shared_ptr<const BufferSource> blob, bool verifyData)
+{
+	if (!blob)
+	{
+		return std::nullopt;
+	}
+
+	const ByteSpan all = blob->data();
+	Header header;
+	if (all.size() < sizeof(Header))
+	{
+		return std::nullopt;
+	}
+	std::memcpy(&header, all.data(), sizeof(Header));
+
+	const size_t directoryEnd = sizeof(Header) + header.bufferCount * sizeof(BufferEntry);
+	if (header.magic != MAGIC || header.version != BAKED_VERSION || header.fileSize != all.size()
+		|| header.bufferCount > all.size() / sizeof(BufferEntry) || header.tablesOffset != directoryEnd
+		|| header.tablesSize > all.size() - header.tablesOffset)
+	{
+		return std::nullopt;
+	}
+
+	const ByteSpan tables = all.subspan(header.tablesOffset, header.tablesSize);
+	if (hashBytes(tables) != header.tablesHash)
+	{
+		return std::nullopt;
+	}
+	if (verifyData && hashBytes(all.subspan(header.tablesOffset + header.tablesSize),
+								hashBytes(all.subspan(sizeof(Header), directoryEnd - sizeof(Header)))) != header.dataHash)
+	{
+		return std::nullopt;
+	}
+
+	BakeReader reader(tables);
+	std::string_view path;
+	reader.read(path);
+	BakedModel baked{Model(std::string(path)), {}, header.sourceHash};
+	baked.model.storage.data = blob;
+	reader.read(baked.model);
+	if (!reader.ok() || baked.model.buffers.size() != header.bufferCount)
+	{
+		return std::nullopt;
+	}
+
+	baked.buffers.reserve(header.bufferCount);
+	for (size_t i = 0; i < header.bufferCount; ++i)
+	{
+		BufferEntry entry;
+		std::memcpy(&entry, all.data() + sizeof(Header) + i * sizeof(BufferEntry), sizeof(BufferEntry));
+		if (entry.offset > all.size() || entry.size > all.size() - entry.offset)
+		{
+			return std::nullopt;
+		}
+		baked.buffers.push_back(std::make_shared<SharedBufferSource>(blob, all.subspan(entry.offset, entry.size)));
+	}
+	return baked;
+}
+
+std::optional<BakedModel> Boiler::gltf::loadBaked(const std::string &path, bool verifyData)
+{
+	return loadBaked(MappedBufferSource::open(path), verifyData);
+}
@@ -0,0 +1,51 @@
+#ifndef BAKED_H
+#define BAKED_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "buffersource.h"
+#include "gltf.h"
+
+// A baked model is a Model and all of its buffers in one relocatable blob:
+// a fixed header, the model's tables in a flat little-endian encoding that
+// refers to nothing outside the blob, then every buffer aligned to
+// BAKED_ALIGNMENT. Loading maps the file, checks the header and rebuilds the
+// Model in one pass; its strings and buffers stay views into the mapping.
+
+namespace Boiler { namespace gltf
+{
+	constexpr uint32_t BAKED_VERSION = 2;
+	constexpr size_t BAKED_ALIGNMENT = 64;
+
+	struct BakedModel
+	{
+		Model model;
+		// one per model buffer, views into the blob, for ModelAccessors
+		BufferSources buffers;
+		// whatever the baker passed in, e.g. a hash of the source files, so
+		// callers can tell a stale bake from a current one
+		uint64_t sourceHash;
+	};
+
+	// FNV-1a style 64-bit hash, taking eight bytes at a time. Detects
+	// corruption, not tampering.
+	uint64_t hashBytes(ByteSpan data, uint64_t hash = 0xcbf29ce484222325ull);
+
+	// Serializes model and its buffers, buffers[i] holding the bytes of
+	// model.buffers[i]. Missing buffers are baked empty.
+	std::vector<std::byte> bakeModel(const Model &model, const std::vector<ByteSpan> &buffers, uint64_t sourceHash = 0);
+	bool writeBakedModel(const std::string &path, const Model &model, const std::vector<ByteSpan> &buffers,
+						 uint64_t sourceHash = 0);
+
+	// Checks the header's magic, version, size and the hash of the model
+	// tables, and the hash of the buffer bytes too if verifyData is set,
+	// which reads every page. Returns nullopt if any check fails. The model
+	// keeps blob alive.
+	std::optional<BakedModel> loadBaked(std::shared_ptr<const BufferSource> blob, bool verifyData = false);
+	// maps the file and loads it as above
+	std::optional<BakedModel> loadBaked(const std::string &path, bool verifyData = false);
+}}
+
+#endif /* BAKED_H */
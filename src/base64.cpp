@@ -0,0 +1,242 @@
+#include <array>
+#include <cstdint>
+#include "base64.h"
+#include "simd.h"
+
+namespace
+{
+	constexpr uint8_t INVALID = 0xFF;
+
+	constexpr std::array<uint8_t, 256> makeDecodeTable()
+	{
+		std::array<uint8_t, 256> table{};
+		for (auto &entry : table)
+		{
+			entry = INVALID;
+		}
+
+		constexpr std::string_view alphabet("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/");
+		for (size_t i = 0; i < alphabet.size(); ++i)
+		{
+			table[static_cast<uint8_t>(alphabet[i])] = static_cast<uint8_t>(i);
+		}
+		return table;
+	}
+
+	constexpr std::array<uint8_t, 256> decodeTable = makeDecodeTable();
+
+	std::string_view stripPadding(std::string_view encoded)
+	{
+		for (int i = 0; i < 2 && !encoded.empty() && encoded.back() == '='; ++i)
+		{
+			encoded.remove_suffix(1);
+		}
+		return encoded;
+	}
+
+	// decodes unpadded input, returns the number of bytes written
+	std::optional<size_t> decodeTail(std::string_view encoded, std::byte *output)
+	{
+		if (encoded.size() % 4 == 1)
+		{
+			return std::nullopt;
+		}
+
+		std::byte *out = output;
+		size_t i = 0;
+		for (; i + 4 <= encoded.size(); i += 4)
+		{
+			const uint8_t a = decodeTable[static_cast<uint8_t>(encoded[i])];
+			const uint8_t b = decodeTable[static_cast<uint8_t>(encoded[i + 1])];
+			const uint8_t c = decodeTable[static_cast<uint8_t>(encoded[i + 2])];
+			const uint8_t d = decodeTable[static_cast<uint8_t>(encoded[i + 3])];
+			if ((a | b | c | d) & 0xC0)
+			{
+				return std::nullopt;
+			}
+
+			const uint32_t triple = (a << 18) | (b << 12) | (c << 6) | d;
+			*out++ = static_cast<std::byte>(triple >> 16);
+			*out++ = static_cast<std::byte>(triple >> 8);
+			*out++ = static_cast<std::byte>(triple);
+		}
+
+		const size_t remaining = encoded.size() - i;
+		if (remaining > 0)
+		{
+			uint32_t triple = 0;
+			for (size_t j = 0; j < remaining; ++j)
+			{
+				const uint8_t value = decodeTable[static_cast<uint8_t>(encoded[i + j])];
+				if (value == INVALID)
+				{
+					return std::nullopt;
+				}
+				triple |= value << (18 - 6 * j);
+			}
+
+			*out++ = static_cast<std::byte>(triple >> 16);
+			if (remaining == 3)
+			{
+				*out++ = static_cast<std::byte>(triple >> 8);
+			}
+		}
+
+		return out - output;
+	}
+
+#ifdef BOILER_GLTF_X86
+	// Vector decoding after Muła and Lemire, "Faster Base64 Encoding and
+	// Decoding Using AVX2 Instructions". Characters are validated and mapped to
+	// their 6-bit values with nibble lookups, then packed 4:3 with multiply-adds.
+
+	BOILER_TARGET_SSSE3
+	bool translateSSE(__m128i &values)
+	{
+		const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+											0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+		const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+											0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+		const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+											  0, 0, 0, 0, 0, 0, 0, 0);
+		const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+
+		const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(values, 4), nibbleMask);
+		const __m128i loNibbles = _mm_and_si128(values, nibbleMask);
+		const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+		const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+		if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())))
+		{
+			return false;
+		}
+
+		const __m128i eqSlash = _mm_cmpeq_epi8(values, _mm_set1_epi8('/'));
+		const __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eqSlash, hiNibbles));
+		values = _mm_add_epi8(values, roll);
+		return true;
+	}
+
+	BOILER_TARGET_SSSE3
+	size_t decodeSSSE3(std::string_view &encoded, std::byte *output, size_t outputSize)
+	{
+		const __m128i packShuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+		size_t written = 0;
+		// each block stores 16 bytes of which 12 are valid
+		while (encoded.size() >= 16 && outputSize - written >= 16)
+		{
+			__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(encoded.data()));
+			if (!translateSSE(values))
+			{
+				break; // let the scalar path report the error
+			}
+
+			const __m128i mergedPairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+			const __m128i merged = _mm_madd_epi16(mergedPairs, _mm_set1_epi32(0x00011000));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(output + written), _mm_shuffle_epi8(merged, packShuffle));
+
+			encoded.remove_prefix(16);
+			written += 12;
+		}
+		return written;
+	}
+
+	BOILER_TARGET_AVX2
+	size_t decodeAVX2(std::string_view &encoded, std::byte *output, size_t outputSize)
+	{
+		const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+											   0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+											   0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+											   0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+		const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+											   0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+											   0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+											   0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+		const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+												 0, 0, 0, 0, 0, 0, 0, 0,
+												 0, 16, 19, 4, -65, -65, -71, -71,
+												 0, 0, 0, 0, 0, 0, 0, 0);
+		const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+		const __m256i packShuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+													 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+		const __m256i packLanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+		size_t written = 0;
+		// each block stores 32 bytes of which 24 are valid
+		while (encoded.size() >= 32 && outputSize - written >= 32)
+		{
+			__m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(encoded.data()));
+
+			const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(values, 4), nibbleMask);
+			const __m256i loNibbles = _mm256_and_si256(values, nibbleMask);
+			const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+			const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+			if (!_mm256_testz_si256(lo, hi))
+			{
+				break;
+			}
+
+			const __m256i eqSlash = _mm256_cmpeq_epi8(values, _mm256_set1_epi8('/'));
+			const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eqSlash, hiNibbles));
+			values = _mm256_add_epi8(values, roll);
+
+			const __m256i mergedPairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+			__m256i merged = _mm256_madd_epi16(mergedPairs, _mm256_set1_epi32(0x00011000));
+			merged = _mm256_shuffle_epi8(merged, packShuffle);
+			merged = _mm256_permutevar8x32_epi32(merged, packLanes);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(output + written), merged);
+
+			encoded.remove_prefix(32);
+			written += 24;
+		}
+		return written;
+	}
+#endif
+}
+
+namespace Boiler { namespace gltf { namespace base64
+{
+	size_t decodedSize(std::string_view encoded)
+	{
+		encoded = stripPadding(encoded);
+		return encoded.size() / 4 * 3 + (encoded.size() % 4 * 3) / 4;
+	}
+
+	std::optional<size_t> decodeScalar(std::string_view encoded, std::span<std::byte> output)
+	{
+		encoded = stripPadding(encoded);
+		if (output.size() < decodedSize(encoded))
+		{
+			return std::nullopt;
+		}
+		return decodeTail(encoded, output.data());
+	}
+
+	std::optional<size_t> decode(std::string_view encoded, std::span<std::byte> output)
+	{
+		encoded = stripPadding(encoded);
+		if (output.size() < decodedSize(encoded))
+		{
+			return std::nullopt;
+		}
+
+		size_t written = 0;
+#ifdef BOILER_GLTF_X86
+		if (simd::hasAVX2())
+		{
+			written += decodeAVX2(encoded, output.data(), output.size());
+		}
+		if (simd::hasSSSE3())
+		{
+			written += decodeSSSE3(encoded, output.data() + written, output.size() - written);
+		}
+#endif
+
+		const std::optional<size_t> tail = decodeTail(encoded, output.data() + written);
+		if (!tail.has_value())
+		{
+			return std::nullopt;
+		}
+		return written + tail.value();
+	}
+}}}
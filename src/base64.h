@@ -0,0 +1,25 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace Boiler { namespace gltf { namespace base64
+{
+	// Number of bytes encoded by a padded or unpadded base64 string.
+	size_t decodedSize(std::string_view encoded);
+
+	// Decodes into output, which must hold at least decodedSize(encoded) bytes.
+	// Uses AVX2 or SSSE3 when the CPU supports them. Returns the number of bytes
+	// written, or nullopt if the input contains characters outside the base64
+	// alphabet or is truncated.
+	std::optional<size_t> decode(std::string_view encoded, std::span<std::byte> output);
+
+	// Portable table-driven decoder, used for the tail of the vector paths and
+	// as the baseline they are measured against.
+	std::optional<size_t> decodeScalar(std::string_view encoded, std::span<std::byte> output);
+}}}
+
+#endif /* BASE64_H */
@@ -0,0 +1,352 @@
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include "batchloader.h"
+#include "buffercache.h"
+#include "loadstats.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	bool isGLB(const std::vector<std::byte> &bytes)
+	{
+		return bytes.size() >= 4 && std::memcmp(bytes.data(), "glTF", 4) == 0;
+	}
+}
+
+namespace Boiler { namespace gltf { namespace detail
+{
+	// one file on its way through the stages
+	struct FileLoad
+	{
+		size_t index;
+		// bytes counted against maxInFlightBytes until delivery
+		size_t charged = 0;
+		std::shared_ptr<const std::vector<std::byte>> bytes;
+		std::optional<Model> model;
+		BufferSources buffers;
+		std::atomic<size_t> buffersLeft{0};
+		std::atomic<bool> bufferFailed{false};
+		// set by the first finish, so a stage that throws after handing the
+		// file on can't deliver it twice
+		std::atomic<bool> finished{false};
+	};
+
+	struct Batch : std::enable_shared_from_this<Batch>
+	{
+		const std::vector<std::string> paths;
+		Executor &executor;
+		const BatchOptions options;
+		const BatchCallback onLoaded;
+		std::vector<std::promise<BatchResult>> promises;
+		std::vector<std::shared_future<BatchResult>> futures;
+		std::atomic<bool> cancelled{false};
+
+		std::mutex mutex;
+		size_t nextFile = 0;
+		size_t inFlightBytes = 0;
+		size_t inFlightFiles = 0;
+
+		Batch(std::vector<std::string> paths, Executor &executor, BatchOptions options, BatchCallback onLoaded)
+			: paths(std::move(paths)), executor(executor), options(options), onLoaded(std::move(onLoaded)),
+			  promises(this->paths.size())
+		{
+			futures.reserve(promises.size());
+			for (auto &promise : promises)
+			{
+				futures.push_back(promise.get_future().share());
+			}
+		}
+
+		// the callback runs first, so once wait() returns every callback has
+		// finished
+		void deliver(size_t index, BatchResult result)
+		{
+			if (onLoaded)
+			{
+				onLoaded(index, result);
+			}
+			promises[index].set_value(std::move(result));
+		}
+
+		// starts files while the budget allows, or cancels them all
+		void admit()
+		{
+			std::vector<std::shared_ptr<FileLoad>> started;
+			size_t cancelFrom = paths.size(), cancelTo = paths.size();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (cancelled)
+				{
+					cancelFrom = nextFile;
+					nextFile = paths.size();
+				}
+				while (nextFile < paths.size())
+				{
+					std::error_code error;
+					const uintmax_t size = std::filesystem::file_size(paths[nextFile], error);
+					const size_t charge = error ? 0 : static_cast<size_t>(size);
+					if (inFlightFiles > 0 && inFlightBytes + charge > options.maxInFlightBytes)
+					{
+						break;
+					}
+
+					auto file = std::make_shared<FileLoad>();
+					file->index = nextFile++;
+					file->charged = charge;
+					inFlightBytes += charge;
+					++inFlightFiles;
+					started.push_back(std::move(file));
+				}
+			}
+
+			for (size_t index = cancelFrom; index < cancelTo; ++index)
+			{
+				deliver(index, BatchResult{paths[index], std::nullopt, {}, BatchError::Cancelled});
+			}
+			for (auto &file : started)
+			{
+				try
+				{
+					executor.submit([batch = shared_from_this(), file]() { batch->read(file); });
+				}
+				catch (...)
+				{
+					finish(file, BatchError::ReadFailed);
+				}
+			}
+		}
+
+		// Runs a stage, finishing the file with error if it throws, so every
+		// file's future is set whatever goes wrong.
+		template<typename Stage>
+		void guarded(const std::shared_ptr<FileLoad> &file, BatchError error, Stage &&stage)
+		{
+			try
+			{
+				stage();
+			}
+			catch (...)
+			{
+				finish(file, error);
+			}
+		}
+
+		void finish(const std::shared_ptr<FileLoad> &file, BatchError error)
+		{
+			if (file->finished.exchange(true))
+			{
+				return;
+			}
+			BatchResult result{paths[file->index], std::move(file->model), std::move(file->buffers), error};
+			if (error == BatchError::Cancelled || error == BatchError::ReadFailed || error == BatchError::ParseFailed)
+			{
+				result.model.reset();
+				result.buffers.clear();
+			}
+			file->bytes.reset();
+			deliver(file->index, std::move(result));
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				inFlightBytes -= file->charged;
+				--inFlightFiles;
+			}
+			admit();
+		}
+
+		void read(const std::shared_ptr<FileLoad> &file)
+		{
+			guarded(file, BatchError::ReadFailed, [&]() { readFile(file); });
+		}
+
+		void readFile(const std::shared_ptr<FileLoad> &file)
+		{
+			if (cancelled)
+			{
+				return finish(file, BatchError::Cancelled);
+			}
+
+			std::ifstream stream(paths[file->index], std::ios::binary | std::ios::ate);
+			if (!stream)
+			{
+				return finish(file, BatchError::ReadFailed);
+			}
+			// directories open, but have no size
+			const std::streamoff size = stream.tellg();
+			if (size < 0)
+			{
+				return finish(file, BatchError::ReadFailed);
+			}
+			auto bytes = std::make_shared<std::vector<std::byte>>(static_cast<size_t>(size));
+			stream.seekg(0);
+			if (!stream.read(reinterpret_cast<char *>(bytes->data()), bytes->size()))
+			{
+				return finish(file, BatchError::ReadFailed);
+			}
+			file->bytes = std::move(bytes);
+
+			executor.submit([batch = shared_from_this(), file]() { batch->parse(file); });
+		}
+
+		void parse(const std::shared_ptr<FileLoad> &file)
+		{
+			guarded(file, BatchError::ParseFailed, [&]() { parseFile(file); });
+		}
+
+		void parseFile(const std::shared_ptr<FileLoad> &file)
+		{
+			if (cancelled)
+			{
+				return finish(file, BatchError::Cancelled);
+			}
+
+			const std::string &path = paths[file->index];
+			ByteSpan bin;
+			// Model has a const path, so it can only be constructed, not assigned
+			const auto parseModel = [&]() -> std::optional<Model>
+			{
+				if (!isGLB(*file->bytes))
+				{
+					return loadStreaming(path, std::string_view(reinterpret_cast<const char *>(file->bytes->data()),
+																 file->bytes->size()));
+				}
+				const std::optional<GLBChunks> chunks = parseGLB(*file->bytes);
+				if (!chunks.has_value())
+				{
+					return std::nullopt;
+				}
+				bin = chunks->bin;
+				return loadStreaming(path, chunks->json);
+			};
+
+			std::optional<Model> parsed = parseModel();
+			if (!parsed.has_value())
+			{
+				return finish(file, BatchError::ParseFailed);
+			}
+			file->model.emplace(std::move(parsed.value()));
+
+			const Model &model = file->model.value();
+			if (!options.loadBuffers || model.buffers.empty())
+			{
+				return finish(file, BatchError::None);
+			}
+
+			size_t bufferBytes = 0;
+			for (const Buffer &buffer : model.buffers)
+			{
+				bufferBytes += buffer.uri.empty() ? 0 : buffer.byteLength;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				inFlightBytes += bufferBytes;
+			}
+			file->charged += bufferBytes;
+
+			const size_t bufferCount = model.buffers.size();
+			file->buffers.resize(bufferCount);
+			const Buffer &first = model.buffers[0];
+			if (first.uri.empty() && first.byteLength <= bin.size())
+			{
+				// a GLB's first buffer is its BIN chunk, which keeps the file's bytes alive
+				file->buffers[0] = std::make_shared<SharedBufferSource>(file->bytes, bin.first(first.byteLength));
+			}
+			file->bytes.reset();
+
+			// one extra count held until every buffer is submitted, so the
+			// model can't be finished and moved out from under this loop
+			const std::string basePath = std::filesystem::path(path).parent_path().string();
+			file->buffersLeft = bufferCount + 1;
+			for (size_t i = 0; i < bufferCount; ++i)
+			{
+				if (model.buffers[i].uri.empty())
+				{
+					if (!file->buffers[i])
+					{
+						file->bufferFailed = true;
+					}
+					bufferDone(file);
+					continue;
+				}
+				try
+				{
+					executor.submit([batch = shared_from_this(), file, basePath, i]() {
+						batch->loadBuffer(file, basePath, i);
+					});
+				}
+				catch (...)
+				{
+					file->bufferFailed = true;
+					bufferDone(file);
+				}
+			}
+			bufferDone(file);
+		}
+
+		void loadBuffer(const std::shared_ptr<FileLoad> &file, const std::string &basePath, size_t i)
+		{
+			if (!cancelled)
+			{
+				try
+				{
+					const Buffer &buffer = file->model->buffers[i];
+					BufferTimer timer(options.observer);
+					BufferLoadResult result = options.cache ? options.cache->load(basePath, buffer)
+															: readBuffer(basePath, buffer);
+					timer.end(i, result.source ? result.source->data().size() : 0);
+					file->buffers[i] = std::move(result.source);
+				}
+				catch (...)
+				{
+					file->buffers[i].reset();
+				}
+			}
+			if (!file->buffers[i])
+			{
+				file->bufferFailed = true;
+			}
+			bufferDone(file);
+		}
+
+		void bufferDone(const std::shared_ptr<FileLoad> &file)
+		{
+			if (file->buffersLeft.fetch_sub(1) != 1)
+			{
+				return;
+			}
+			finish(file, cancelled ? BatchError::Cancelled
+						 : file->bufferFailed ? BatchError::BufferFailed : BatchError::None);
+		}
+	};
+}}}
+
+const std::vector<std::shared_future<BatchResult>> &BatchLoad::results() const
+{
+	return batch->futures;
+}
+
+void BatchLoad::cancel()
+{
+	batch->cancelled = true;
+	batch->admit();
+}
+
+void BatchLoad::wait() const
+{
+	for (const auto &future : batch->futures)
+	{
+		future.wait();
+	}
+}
+
+BatchLoad Boiler::gltf::loadBatch(std::vector<std::string> paths, Executor &executor, BatchOptions options,
+								  BatchCallback onLoaded)
+{
+	auto batch = std::make_shared<detail::Batch>(std::move(paths), executor, options, std::move(onLoaded));
+	batch->admit();
+	return BatchLoad(batch);
+}
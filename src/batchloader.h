@@ -0,0 +1,87 @@
+#ifndef BATCHLOADER_H
+#define BATCHLOADER_H
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "buffersource.h"
+#include "gltf.h"
+#include "threadpool.h"
+
+namespace Boiler { namespace gltf
+{
+	class BufferCache;
+
+	enum class BatchError
+	{
+		None,
+		Cancelled,
+		ReadFailed,
+		ParseFailed,
+		BufferFailed // the model parsed, but at least one buffer didn't load
+	};
+
+	struct BatchResult
+	{
+		std::string path;
+		// set unless reading or parsing failed or the load was cancelled first
+		std::optional<Model> model;
+		// one per model buffer, failed ones null, for ModelAccessors
+		BufferSources buffers;
+		BatchError error = BatchError::None;
+
+		bool ok() const { return error == BatchError::None; }
+	};
+
+	using BatchCallback = std::function<void(size_t index, const BatchResult &result)>;
+
+	struct BatchOptions
+	{
+		// Files are started only while the bytes of files and buffers read but
+		// not yet delivered stay below this. One file is always let through,
+		// however large.
+		size_t maxInFlightBytes = size_t(256) << 20;
+		bool loadBuffers = true;
+		// if set, buffers are shared through it rather than read per model
+		BufferCache *cache = nullptr;
+		// if set, told each buffer's size and read time from the worker
+		// threads, with its index within its model
+		LoadObserver *observer = nullptr;
+	};
+
+	namespace detail
+	{
+		struct Batch;
+	}
+
+	// Handle to a running batch. Dropping it doesn't cancel the batch.
+	class BatchLoad
+	{
+		std::shared_ptr<detail::Batch> batch;
+
+	public:
+		explicit BatchLoad(std::shared_ptr<detail::Batch> batch) : batch(std::move(batch)) {}
+
+		// one per path, in the order given
+		const std::vector<std::shared_future<BatchResult>> &results() const;
+		// Files not yet started complete as Cancelled straight away, the rest
+		// at their next stage.
+		void cancel();
+		void wait() const;
+	};
+
+	// Loads every file on executor as a pipeline of independent tasks: read
+	// the file, parse it (.gltf or .glb), then read each of its buffers,
+	// relative to the file. Stages of different files overlap, and a
+	// WorkStealingPool keeps a file's follow-up stages on the worker that
+	// ran the one before. onLoaded, if given, runs on the worker thread with
+	// a file's result just before its future is made ready, so wait()
+	// returns only once every callback has, and must not throw.
+	BatchLoad loadBatch(std::vector<std::string> paths, Executor &executor, BatchOptions options = {},
+						BatchCallback onLoaded = {});
+}}
+
+#endif /* BATCHLOADER_H */
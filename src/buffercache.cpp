@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include "baked.h"
+#include "buffercache.h"
+#include "loadstats.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	struct PathKey
+	{
+		std::string path;
+		uint64_t byteLength;
+
+		auto operator<=>(const PathKey &) const = default;
+	};
+
+	struct ContentKey
+	{
+		uint64_t hash;
+		uint64_t size;
+
+		auto operator<=>(const ContentKey &) const = default;
+	};
+
+	std::string resolvePath(const std::string &basePath, std::string_view uri)
+	{
+		std::filesystem::path bufferPath(basePath);
+		bufferPath.append(uri);
+		std::error_code error;
+		const std::filesystem::path resolved = std::filesystem::weakly_canonical(bufferPath, error);
+		return error ? bufferPath.lexically_normal().string() : resolved.string();
+	}
+}
+
+// A loaded buffer that removes itself from the cache once the last model
+// using it lets go.
+class BufferCache::CachedBuffer : public BufferSource
+{
+	std::shared_ptr<const BufferSource> source;
+
+public:
+	std::weak_ptr<State> state;
+	// guarded by the state's mutex
+	mutable std::vector<PathKey> paths;
+	std::optional<ContentKey> content;
+
+	explicit CachedBuffer(std::shared_ptr<const BufferSource> source) : source(std::move(source)) {}
+	~CachedBuffer();
+
+	ByteSpan data() const override { return source->data(); }
+};
+
+struct BufferCache::State
+{
+	struct Slot
+	{
+		// identifies the live buffer, which may already be expiring
+		const CachedBuffer *buffer = nullptr;
+		std::weak_ptr<const CachedBuffer> source;
+		// valid while the first load of the slot is reading
+		std::shared_future<BufferLoadResult> pending;
+	};
+
+	const bool shareIdenticalContent;
+	std::mutex mutex;
+	std::map<PathKey, Slot> paths;
+	std::map<ContentKey, Slot> contents;
+	Stats counters;
+
+	explicit State(bool shareIdenticalContent) : shareIdenticalContent(shareIdenticalContent) {}
+};
+
+BufferCache::CachedBuffer::~CachedBuffer()
+{
+	const std::shared_ptr<State> owner = state.lock();
+	if (!owner)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(owner->mutex);
+	// a slot may have been refilled with a fresh load after this one expired
+	for (const PathKey &key : paths)
+	{
+		const auto found = owner->paths.find(key);
+		if (found != owner->paths.end() && found->second.buffer == this)
+		{
+			owner->paths.erase(found);
+		}
+	}
+	if (content.has_value())
+	{
+		const auto found = owner->contents.find(content.value());
+		if (found != owner->contents.end() && found->second.buffer == this)
+		{
+			owner->contents.erase(found);
+		}
+	}
+	owner->counters.residentBytes -= data().size();
+	--owner->counters.residentBuffers;
+}
+
+BufferCache::BufferCache(bool shareIdenticalContent)
+	: state(std::make_shared<State>(shareIdenticalContent))
+{
+}
+
+BufferCache &BufferCache::global()
+{
+	static BufferCache cache;
+	return cache;
+}
+
+BufferLoadResult BufferCache::load(const std::string &basePath, const Buffer &buffer)
+{
+	if (buffer.uri.empty() || parseDataUri(buffer.uri).has_value())
+	{
+		return readBuffer(basePath, buffer);
+	}
+
+	const PathKey key{resolvePath(basePath, buffer.uri), buffer.byteLength};
+	std::promise<BufferLoadResult> loaded;
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		State::Slot &slot = state->paths[key];
+		if (std::shared_ptr<const CachedBuffer> source = slot.source.lock())
+		{
+			++state->counters.hits;
+			return BufferLoadResult{std::move(source)};
+		}
+		if (slot.pending.valid())
+		{
+			++state->counters.hits;
+			const std::shared_future<BufferLoadResult> pending = slot.pending;
+			lock.unlock();
+			return pending.get();
+		}
+		++state->counters.misses;
+		slot = State::Slot{};
+		slot.pending = loaded.get_future().share();
+	}
+
+	BufferLoadResult result = readBuffer(basePath, buffer);
+	std::shared_ptr<CachedBuffer> cached;
+	std::optional<ContentKey> content;
+	if (result.ok())
+	{
+		cached = std::make_shared<CachedBuffer>(std::move(result.source));
+		if (state->shareIdenticalContent)
+		{
+			content = ContentKey{hashBytes(cached->data()), cached->data().size()};
+		}
+	}
+
+	// dropping either of these can run a CachedBuffer's destructor, which
+	// locks the mutex, so they outlive the locked scope
+	std::shared_ptr<const CachedBuffer> shared, existing;
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		if (!cached)
+		{
+			state->paths.erase(key);
+		}
+		else
+		{
+			if (content.has_value())
+			{
+				State::Slot &contentSlot = state->contents[content.value()];
+				existing = contentSlot.source.lock();
+				const ByteSpan bytes = cached->data();
+				if (existing && std::equal(bytes.begin(), bytes.end(), existing->data().begin()))
+				{
+					++state->counters.contentHits;
+					shared = existing;
+				}
+				else if (!existing)
+				{
+					cached->content = content;
+					contentSlot = State::Slot{cached.get(), cached, {}};
+				}
+			}
+			if (!shared)
+			{
+				cached->state = state;
+				state->counters.residentBytes += cached->data().size();
+				++state->counters.residentBuffers;
+				shared = cached;
+			}
+
+			shared->paths.push_back(key);
+			State::Slot &slot = state->paths[key];
+			slot.buffer = shared.get();
+			slot.source = shared;
+			slot.pending = {};
+			result.source = shared;
+		}
+	}
+	loaded.set_value(result);
+	return result;
+}
+
+BufferCache::Stats BufferCache::stats() const
+{
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->counters;
+}
+
+std::vector<BufferLoad> Boiler::gltf::loadBuffers(const Model &model, const std::string &basePath, Executor &executor,
+												   BufferCache &cache, BufferLoadCallback onLoaded, LoadObserver *observer)
+{
+	std::vector<BufferLoad> loads;
+	loads.reserve(model.buffers.size());
+
+	auto callback = std::make_shared<const BufferLoadCallback>(std::move(onLoaded));
+	auto sharedBasePath = std::make_shared<const std::string>(basePath);
+
+	for (size_t i = 0; i < model.buffers.size(); ++i)
+	{
+		auto promise = std::make_shared<std::promise<BufferLoadResult>>();
+		loads.push_back(promise->get_future().share());
+
+		executor.submit([i, promise, callback, sharedBasePath, &cache, observer, buffer = model.buffers[i],
+						 storage = model.storage.data]() {
+			BufferTimer timer(observer);
+			const BufferLoadResult result = cache.load(*sharedBasePath, buffer);
+			timer.end(i, result.source ? result.source->data().size() : 0);
+			if (*callback)
+			{
+				(*callback)(i, result);
+			}
+			promise->set_value(result);
+		});
+	}
+
+	return loads;
+}
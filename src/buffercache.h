@@ -0,0 +1,61 @@
+#ifndef BUFFERCACHE_H
+#define BUFFERCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "buffersource.h"
+#include "gltf.h"
+#include "threadpool.h"
+
+namespace Boiler { namespace gltf
+{
+	// Shares buffer files between models, e.g. LODs and material variants
+	// that reference the same .bin. Buffers are keyed by their resolved path
+	// and byteLength, and optionally also by a hash of their contents so
+	// identical files under different paths share one copy too. The cache
+	// only refers to its buffers weakly: each stays resident while any
+	// ModelAccessors or other holder of its source is alive. Thread safe, and
+	// concurrent loads of the same buffer read the file once.
+	class BufferCache
+	{
+	public:
+		struct Stats
+		{
+			// loads served by a resident buffer or one already being read
+			uint64_t hits = 0;
+			// loads that read the file
+			uint64_t misses = 0;
+			// misses whose bytes matched a resident buffer, whose copy is shared
+			uint64_t contentHits = 0;
+			size_t residentBytes = 0;
+			size_t residentBuffers = 0;
+		};
+
+	private:
+		struct State;
+		class CachedBuffer;
+
+		std::shared_ptr<State> state;
+
+	public:
+		explicit BufferCache(bool shareIdenticalContent = true);
+
+		// the process-wide cache
+		static BufferCache &global();
+
+		// Like readBuffer, but returns the resident copy if there is one. Data
+		// uris aren't files and are always decoded afresh.
+		BufferLoadResult load(const std::string &basePath, const Buffer &buffer);
+
+		Stats stats() const;
+	};
+
+	// loadBuffers, reading through cache
+	std::vector<BufferLoad> loadBuffers(const Model &model, const std::string &basePath, Executor &executor,
+										BufferCache &cache, BufferLoadCallback onLoaded = {},
+										LoadObserver *observer = nullptr);
+}}
+
+#endif /* BUFFERCACHE_H */
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include "buffersource.h"
+#include "loadstats.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Boiler::gltf;
+
+MappedBufferSource::MappedBufferSource(void *mapping, size_t mappingSize)
+	: mapping(mapping), mappingSize(mappingSize),
+	  view(static_cast<const std::byte *>(mapping), mappingSize)
+{
+}
+
+MappedBufferSource::~MappedBufferSource()
+{
+	if (mapping)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mapping);
+#else
+		munmap(mapping, mappingSize);
+#endif
+	}
+}
+
+std::shared_ptr<MappedBufferSource> MappedBufferSource::open(const std::string &path)
+{
+	void *mapping = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+							  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return nullptr;
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	if (size > 0)
+	{
+		HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (fileMapping)
+		{
+			mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+			// the view keeps the mapping object alive
+			CloseHandle(fileMapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0)
+	{
+		::close(fd);
+		return nullptr;
+	}
+	size = static_cast<size_t>(fileStat.st_size);
+
+	if (size > 0)
+	{
+		mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED)
+		{
+			mapping = nullptr;
+		}
+	}
+	// the mapping stays valid after the descriptor is closed
+	::close(fd);
+#endif
+
+	if (size > 0 && !mapping)
+	{
+		return nullptr;
+	}
+	return std::shared_ptr<MappedBufferSource>(new MappedBufferSource(mapping, size));
+}
+
+BufferFile::~BufferFile()
+{
+#ifdef _WIN32
+	CloseHandle(handle);
+#else
+	::close(fd);
+#endif
+}
+
+std::shared_ptr<BufferFile> BufferFile::open(const std::string &path)
+{
+	std::shared_ptr<BufferFile> file;
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+								OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+	file.reset(new BufferFile());
+	file->handle = handle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize))
+	{
+		return nullptr;
+	}
+	file->fileSize = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+	file.reset(new BufferFile());
+	file->fd = fd;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0)
+	{
+		return nullptr;
+	}
+	file->fileSize = static_cast<uint64_t>(fileStat.st_size);
+#endif
+	return file;
+}
+
+bool BufferFile::read(uint64_t offset, std::span<std::byte> out) const
+{
+	if (offset > fileSize || out.size() > fileSize - offset)
+	{
+		return false;
+	}
+
+	while (!out.empty())
+	{
+#ifdef _WIN32
+		OVERLAPPED position = {};
+		position.Offset = static_cast<DWORD>(offset);
+		position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD count = 0;
+		const DWORD request = static_cast<DWORD>(std::min<size_t>(out.size(), 1u << 30));
+		if (!ReadFile(handle, out.data(), request, &count, &position) || count == 0)
+		{
+			return false;
+		}
+#else
+		const ssize_t count = ::pread(fd, out.data(), out.size(), static_cast<off_t>(offset));
+		if (count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (count <= 0)
+		{
+			return false;
+		}
+#endif
+		offset += static_cast<uint64_t>(count);
+		out = out.subspan(static_cast<size_t>(count));
+	}
+	return true;
+}
+
+std::shared_ptr<const BufferSource> Boiler::gltf::mapBuffer(const std::string &basePath, const Buffer &buffer)
+{
+	std::filesystem::path bufferPath(basePath);
+	bufferPath.append(buffer.uri);
+
+	std::shared_ptr<const MappedBufferSource> file = MappedBufferSource::open(bufferPath.string());
+	if (!file || file->data().size() < buffer.byteLength)
+	{
+		return nullptr;
+	}
+
+	const ByteSpan view = file->data().first(buffer.byteLength);
+	return std::make_shared<SharedBufferSource>(std::move(file), view);
+}
+
+BufferLoadResult Boiler::gltf::readBuffer(const std::string &basePath, const Buffer &buffer)
+{
+	BufferLoadResult result;
+	if (buffer.uri.empty())
+	{
+		result.error = BufferError::MissingUri;
+		return result;
+	}
+
+	std::vector<std::byte> bytes;
+	if (parseDataUri(buffer.uri).has_value())
+	{
+		std::optional<std::vector<std::byte>> decoded = decodeDataUri(buffer.uri);
+		if (!decoded.has_value() || decoded->size() < buffer.byteLength)
+		{
+			result.error = BufferError::InvalidDataUri;
+			return result;
+		}
+		bytes = std::move(decoded.value());
+		bytes.resize(buffer.byteLength);
+	}
+	else
+	{
+		std::filesystem::path bufferPath(basePath);
+		bufferPath.append(buffer.uri);
+
+		std::ifstream ifs(bufferPath, std::ios::binary);
+		if (!ifs)
+		{
+			result.error = BufferError::FileNotFound;
+			return result;
+		}
+
+		bytes.resize(buffer.byteLength);
+		if (!ifs.read(reinterpret_cast<char *>(bytes.data()), buffer.byteLength))
+		{
+			result.error = BufferError::ReadFailed;
+			return result;
+		}
+	}
+
+	result.source = std::make_shared<MemoryBufferSource>(std::move(bytes));
+	return result;
+}
+
+std::vector<BufferLoad> Boiler::gltf::loadBuffers(const Model &model, const std::string &basePath,
+												   Executor &executor, BufferLoadCallback onLoaded,
+												   LoadObserver *observer)
+{
+	std::vector<BufferLoad> loads;
+	loads.reserve(model.buffers.size());
+
+	// shared by all tasks, the storage keeps the buffers' uri views valid
+	auto callback = std::make_shared<const BufferLoadCallback>(std::move(onLoaded));
+	auto sharedBasePath = std::make_shared<const std::string>(basePath);
+
+	for (size_t i = 0; i < model.buffers.size(); ++i)
+	{
+		auto promise = std::make_shared<std::promise<BufferLoadResult>>();
+		loads.push_back(promise->get_future().share());
+
+		executor.submit([i, promise, callback, sharedBasePath, observer, buffer = model.buffers[i],
+						 storage = model.storage.data]() {
+			BufferTimer timer(observer);
+			const BufferLoadResult result = readBuffer(*sharedBasePath, buffer);
+			timer.end(i, result.source ? result.source->data().size() : 0);
+			if (*callback)
+			{
+				(*callback)(i, result);
+			}
+			promise->set_value(result);
+		});
+	}
+
+	return loads;
+}
+
+BufferSources Boiler::gltf::waitForBuffers(const std::vector<BufferLoad> &loads)
+{
+	BufferSources sources;
+	sources.reserve(loads.size());
+	for (const auto &load : loads)
+	{
+		sources.push_back(load.get().source);
+	}
+	return sources;
+}
@@ -0,0 +1,140 @@
+#ifndef BUFFERSOURCE_H
+#define BUFFERSOURCE_H
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gltf.h"
+#include "threadpool.h"
+
+namespace Boiler { namespace gltf
+{
+	// Backing storage for one glTF buffer. Accessors only ever see the span
+	// returned by data(), so where the bytes live is up to the implementation.
+	class BufferSource
+	{
+	public:
+		virtual ~BufferSource() = default;
+		virtual ByteSpan data() const = 0;
+	};
+
+	using BufferSources = std::vector<std::shared_ptr<const BufferSource>>;
+
+	// Heap storage, e.g. the result of loadBuffer.
+	class MemoryBufferSource : public BufferSource
+	{
+		std::vector<std::byte> bytes;
+
+	public:
+		explicit MemoryBufferSource(std::vector<std::byte> bytes) : bytes(std::move(bytes)) {}
+
+		ByteSpan data() const override { return bytes; }
+	};
+
+	// A range of bytes some other object owns, e.g. a GLB's BIN chunk or a
+	// prefix of a mapped file, keeping that owner alive.
+	class SharedBufferSource : public BufferSource
+	{
+		std::shared_ptr<const void> owner;
+		ByteSpan view;
+
+	public:
+		SharedBufferSource(std::shared_ptr<const void> owner, ByteSpan view) : owner(std::move(owner)), view(view) {}
+
+		ByteSpan data() const override { return view; }
+	};
+
+	// A read-only memory mapping of a file. Pages are faulted in from the page
+	// cache as accessors touch them, so nothing is read up front.
+	class MappedBufferSource : public BufferSource
+	{
+		void *mapping;
+		size_t mappingSize;
+		ByteSpan view;
+
+		MappedBufferSource(void *mapping, size_t mappingSize);
+
+	public:
+		~MappedBufferSource();
+		MappedBufferSource(const MappedBufferSource &) = delete;
+		MappedBufferSource &operator=(const MappedBufferSource &) = delete;
+
+		// maps the whole file, returns nullptr if it can't be opened or mapped
+		static std::shared_ptr<MappedBufferSource> open(const std::string &path);
+
+		ByteSpan data() const override { return view; }
+	};
+
+	// An open file read with positioned reads, which don't share a file
+	// offset, so any number of threads can read from it at once.
+	class BufferFile
+	{
+#ifdef _WIN32
+		void *handle;
+#else
+		int fd;
+#endif
+		uint64_t fileSize;
+
+		BufferFile() = default;
+
+	public:
+		~BufferFile();
+		BufferFile(const BufferFile &) = delete;
+		BufferFile &operator=(const BufferFile &) = delete;
+
+		// returns nullptr if the file can't be opened
+		static std::shared_ptr<BufferFile> open(const std::string &path);
+
+		uint64_t size() const { return fileSize; }
+		// fills out with the bytes at offset, false on error or end of file
+		bool read(uint64_t offset, std::span<std::byte> out) const;
+	};
+
+	// Maps the file behind buffer.uri, limited to buffer.byteLength. Returns
+	// nullptr if the file is missing or shorter than byteLength.
+	std::shared_ptr<const BufferSource> mapBuffer(const std::string &basePath, const Buffer &buffer);
+
+	enum class BufferError
+	{
+		None,
+		MissingUri, // e.g. the BIN chunk of a GLB, which the caller provides
+		FileNotFound,
+		ReadFailed, // I/O error or fewer than byteLength bytes
+		InvalidDataUri
+	};
+
+	struct BufferLoadResult
+	{
+		std::shared_ptr<const BufferSource> source;
+		BufferError error = BufferError::None;
+
+		bool ok() const { return error == BufferError::None; }
+	};
+
+	using BufferLoad = std::shared_future<BufferLoadResult>;
+	using BufferLoadCallback = std::function<void(size_t bufferIndex, const BufferLoadResult &result)>;
+
+	// Reads one buffer (file or data uri) into memory, reporting failures
+	// instead of exiting.
+	BufferLoadResult readBuffer(const std::string &basePath, const Buffer &buffer);
+
+	// Reads all of the model's buffers concurrently on executor. Each future is
+	// ready as soon as its buffer has landed, so work on it can start while the
+	// others are still loading. onLoaded, if given, runs on the worker thread
+	// just before, so waitForBuffers returns only once every callback has, and
+	// must not throw. observer, if given, is told each buffer's size and read
+	// time from the worker threads.
+	std::vector<BufferLoad> loadBuffers(const Model &model, const std::string &basePath,
+										Executor &executor, BufferLoadCallback onLoaded = {},
+										LoadObserver *observer = nullptr);
+
+	// Waits for every load and collects the sources for ModelAccessors, failed
+	// buffers are left null.
+	BufferSources waitForBuffers(const std::vector<BufferLoad> &loads);
+}}
+
+#endif /* BUFFERSOURCE_H */
@@ -0,0 +1,404 @@
+#include <type_traits>
+#include "convert.h"
+#include "simd.h"
+
+using namespace Boiler::gltf;
+using namespace Boiler::gltf::convert;
+
+namespace
+{
+	template<ComponentType Type>
+	using ComponentTag = std::integral_constant<ComponentType, Type>;
+
+	// calls func with a ComponentTag for 8- and 16-bit component types
+	template<typename Func>
+	size_t withIntegerType(ComponentType type, Func &&func)
+	{
+		switch (type)
+		{
+			case ComponentType::BYTE: return func(ComponentTag<ComponentType::BYTE>());
+			case ComponentType::UNSIGNED_BYTE: return func(ComponentTag<ComponentType::UNSIGNED_BYTE>());
+			case ComponentType::SHORT: return func(ComponentTag<ComponentType::SHORT>());
+			case ComponentType::UNSIGNED_SHORT: return func(ComponentTag<ComponentType::UNSIGNED_SHORT>());
+			default: return 0;
+		}
+	}
+
+	bool isNarrowInteger(ComponentType type)
+	{
+		return type == ComponentType::BYTE || type == ComponentType::UNSIGNED_BYTE
+			|| type == ComponentType::SHORT || type == ComponentType::UNSIGNED_SHORT;
+	}
+
+	bool isPacked(const Components &src, size_t dstStride)
+	{
+		return dstStride == src.componentCount
+			&& src.stride == src.componentCount * componentSize(src.componentType);
+	}
+
+	// Number of leading elements that can be read and written four components
+	// at a time without touching memory past the last element.
+	size_t wideElementCount(const Components &src)
+	{
+		if (src.count == 0)
+		{
+			return 0;
+		}
+
+		const size_t size = componentSize(src.componentType);
+		const size_t extent = (src.count - 1) * src.stride + src.componentCount * size;
+		const size_t dstExtent = src.count * src.componentCount;
+		if (extent < 4 * size || dstExtent < 4)
+		{
+			return 0;
+		}
+
+		const size_t readable = (extent - 4 * size) / src.stride + 1;
+		const size_t writable = (dstExtent - 4) / src.componentCount + 1;
+		return std::min({readable, writable, src.count});
+	}
+
+#ifdef BOILER_GLTF_X86
+	template<ComponentType Type>
+	constexpr float normalizeDivisor()
+	{
+		if constexpr (Type == ComponentType::BYTE) return 127.0f;
+		else if constexpr (Type == ComponentType::UNSIGNED_BYTE) return 255.0f;
+		else if constexpr (Type == ComponentType::SHORT) return 32767.0f;
+		else return 65535.0f;
+	}
+
+	template<ComponentType Type>
+	constexpr bool isSigned()
+	{
+		return Type == ComponentType::BYTE || Type == ComponentType::SHORT;
+	}
+
+	// widens 4 components to 32-bit lanes, reads 4 * componentSize bytes
+	template<ComponentType Type>
+	BOILER_TARGET_SSE41 __m128i widen4(const std::byte *data)
+	{
+		if constexpr (Type == ComponentType::BYTE)
+			return _mm_cvtepi8_epi32(_mm_cvtsi32_si128(load<int32_t>(data)));
+		else if constexpr (Type == ComponentType::UNSIGNED_BYTE)
+			return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(load<int32_t>(data)));
+		else if constexpr (Type == ComponentType::SHORT)
+			return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(data)));
+		else
+			return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(data)));
+	}
+
+	// widens 8 components to 32-bit lanes, reads 8 * componentSize bytes
+	template<ComponentType Type>
+	BOILER_TARGET_AVX2 __m256i widen8(const std::byte *data)
+	{
+		if constexpr (Type == ComponentType::BYTE)
+			return _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(data)));
+		else if constexpr (Type == ComponentType::UNSIGNED_BYTE)
+			return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(data)));
+		else if constexpr (Type == ComponentType::SHORT)
+			return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)));
+		else
+			return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)));
+	}
+
+	template<ComponentType Type>
+	BOILER_TARGET_SSE41 __m128 toFloat4(__m128i values, bool normalized)
+	{
+		__m128 result = _mm_cvtepi32_ps(values);
+		if (normalized)
+		{
+			result = _mm_div_ps(result, _mm_set1_ps(normalizeDivisor<Type>()));
+			if constexpr (isSigned<Type>())
+			{
+				result = _mm_max_ps(result, _mm_set1_ps(-1.0f));
+			}
+		}
+		return result;
+	}
+
+	template<ComponentType Type>
+	BOILER_TARGET_AVX2 __m256 toFloat8(__m256i values, bool normalized)
+	{
+		__m256 result = _mm256_cvtepi32_ps(values);
+		if (normalized)
+		{
+			result = _mm256_div_ps(result, _mm256_set1_ps(normalizeDivisor<Type>()));
+			if constexpr (isSigned<Type>())
+			{
+				result = _mm256_max_ps(result, _mm256_set1_ps(-1.0f));
+			}
+		}
+		return result;
+	}
+
+	// Packed kernels treat the accessor as one flat run of components and
+	// return how many they converted.
+
+	template<ComponentType Type>
+	BOILER_TARGET_AVX2 size_t packedToFloatAVX2(const std::byte *src, float *dst, size_t total, bool normalized)
+	{
+		constexpr size_t size = componentSize(Type);
+		size_t i = 0;
+		for (; i + 8 <= total; i += 8)
+		{
+			_mm256_storeu_ps(dst + i, toFloat8<Type>(widen8<Type>(src + i * size), normalized));
+		}
+		return i;
+	}
+
+	template<ComponentType Type>
+	BOILER_TARGET_SSE41 size_t packedToFloatSSE41(const std::byte *src, float *dst, size_t total, bool normalized)
+	{
+		constexpr size_t size = componentSize(Type);
+		size_t i = 0;
+		for (; i + 4 <= total; i += 4)
+		{
+			_mm_storeu_ps(dst + i, toFloat4<Type>(widen4<Type>(src + i * size), normalized));
+		}
+		return i;
+	}
+
+	template<ComponentType Type>
+	BOILER_TARGET_AVX2 size_t packedToUIntAVX2(const std::byte *src, uint32_t *dst, size_t total)
+	{
+		constexpr size_t size = componentSize(Type);
+		size_t i = 0;
+		for (; i + 8 <= total; i += 8)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), widen8<Type>(src + i * size));
+		}
+		return i;
+	}
+
+	template<ComponentType Type>
+	BOILER_TARGET_SSE41 size_t packedToUIntSSE41(const std::byte *src, uint32_t *dst, size_t total)
+	{
+		constexpr size_t size = componentSize(Type);
+		size_t i = 0;
+		for (; i + 4 <= total; i += 4)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), widen4<Type>(src + i * size));
+		}
+		return i;
+	}
+
+	// 16-bit destinations only vectorize the index types. Unsigned ints are
+	// truncated like static_cast, by masking before the saturating pack.
+
+	BOILER_TARGET_AVX2 size_t packedBytesToUShortAVX2(const std::byte *src, uint16_t *dst, size_t total)
+	{
+		size_t i = 0;
+		for (; i + 16 <= total; i += 16)
+		{
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_cvtepu8_epi16(bytes));
+		}
+		return i;
+	}
+
+	BOILER_TARGET_SSE41 size_t packedBytesToUShortSSE41(const std::byte *src, uint16_t *dst, size_t total)
+	{
+		size_t i = 0;
+		for (; i + 8 <= total; i += 8)
+		{
+			const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_cvtepu8_epi16(bytes));
+		}
+		return i;
+	}
+
+	BOILER_TARGET_AVX2 size_t packedUIntToUShortAVX2(const std::byte *src, uint16_t *dst, size_t total)
+	{
+		const __m256i mask = _mm256_set1_epi32(0xffff);
+		size_t i = 0;
+		for (; i + 16 <= total; i += 16)
+		{
+			const __m256i low = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4)), mask);
+			const __m256i high = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4 + 32)), mask);
+			// the pack works within 128-bit lanes, so put the quarters back in order
+			const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+		}
+		return i;
+	}
+
+	BOILER_TARGET_SSE41 size_t packedUIntToUShortSSE41(const std::byte *src, uint16_t *dst, size_t total)
+	{
+		const __m128i mask = _mm_set1_epi32(0xffff);
+		size_t i = 0;
+		for (; i + 8 <= total; i += 8)
+		{
+			const __m128i low = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4)), mask);
+			const __m128i high = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 16)), mask);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi32(low, high));
+		}
+		return i;
+	}
+
+	// Interleaved kernels convert one element of up to four components per
+	// iteration, writing four lanes that the next element then overwrites.
+	// They return how many elements they converted.
+
+	template<ComponentType Type>
+	BOILER_TARGET_SSE41 size_t stridedToFloatSSE41(const Components &src, float *dst)
+	{
+		const size_t count = wideElementCount(src);
+		const std::byte *element = src.data;
+		for (size_t i = 0; i < count; ++i, element += src.stride)
+		{
+			_mm_storeu_ps(dst + i * src.componentCount, toFloat4<Type>(widen4<Type>(element), src.normalized));
+		}
+		return count;
+	}
+
+	template<ComponentType Type>
+	BOILER_TARGET_SSE41 size_t stridedToUIntSSE41(const Components &src, uint32_t *dst)
+	{
+		const size_t count = wideElementCount(src);
+		const std::byte *element = src.data;
+		for (size_t i = 0; i < count; ++i, element += src.stride)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * src.componentCount), widen4<Type>(element));
+		}
+		return count;
+	}
+#endif
+
+	// converts whatever the vector kernels left over
+	template<typename T>
+	void convertRemaining(const Components &src, T *dst, size_t dstStride, size_t doneElements, size_t doneValues)
+	{
+		if (doneValues > 0)
+		{
+			// packed data may have stopped partway through an element
+			const size_t size = componentSize(src.componentType);
+			const size_t total = src.count * src.componentCount;
+			const Components tail{src.data + doneValues * size, total - doneValues, size, 1,
+								  src.componentType, src.normalized};
+			convertScalar(tail, dst + doneValues, 1);
+			return;
+		}
+
+		const Components tail{src.data + doneElements * src.stride, src.count - doneElements, src.stride,
+							  src.componentCount, src.componentType, src.normalized};
+		convertScalar(tail, dst + doneElements * dstStride, dstStride);
+	}
+}
+
+namespace Boiler { namespace gltf { namespace convert
+{
+	void convert(const Components &src, float *dst, size_t dstStride)
+	{
+		const bool packed = isPacked(src, dstStride);
+		if (packed && src.componentType == ComponentType::FLOAT)
+		{
+			std::memcpy(dst, src.data, src.count * src.componentCount * sizeof(float));
+			return;
+		}
+
+		size_t doneElements = 0, doneValues = 0;
+#ifdef BOILER_GLTF_X86
+		if (isNarrowInteger(src.componentType))
+		{
+			const size_t total = src.count * src.componentCount;
+			if (packed && simd::hasAVX2())
+			{
+				doneValues = withIntegerType(src.componentType, [&](auto type) {
+					return packedToFloatAVX2<decltype(type)::value>(src.data, dst, total, src.normalized);
+				});
+			}
+			else if (packed && simd::hasSSE41())
+			{
+				doneValues = withIntegerType(src.componentType, [&](auto type) {
+					return packedToFloatSSE41<decltype(type)::value>(src.data, dst, total, src.normalized);
+				});
+			}
+			else if (!packed && dstStride == src.componentCount && src.componentCount >= 2
+					 && src.componentCount <= 4 && simd::hasSSE41())
+			{
+				doneElements = withIntegerType(src.componentType, [&](auto type) {
+					return stridedToFloatSSE41<decltype(type)::value>(src, dst);
+				});
+			}
+		}
+#endif
+		convertRemaining(src, dst, dstStride, doneElements, doneValues);
+	}
+
+	void convert(const Components &src, uint32_t *dst, size_t dstStride)
+	{
+		const bool packed = isPacked(src, dstStride);
+		if (packed && src.componentType == ComponentType::UNSIGNED_INT)
+		{
+			std::memcpy(dst, src.data, src.count * src.componentCount * sizeof(uint32_t));
+			return;
+		}
+
+		size_t doneElements = 0, doneValues = 0;
+#ifdef BOILER_GLTF_X86
+		if (isNarrowInteger(src.componentType))
+		{
+			const size_t total = src.count * src.componentCount;
+			if (packed && simd::hasAVX2())
+			{
+				doneValues = withIntegerType(src.componentType, [&](auto type) {
+					return packedToUIntAVX2<decltype(type)::value>(src.data, dst, total);
+				});
+			}
+			else if (packed && simd::hasSSE41())
+			{
+				doneValues = withIntegerType(src.componentType, [&](auto type) {
+					return packedToUIntSSE41<decltype(type)::value>(src.data, dst, total);
+				});
+			}
+			else if (!packed && dstStride == src.componentCount && src.componentCount >= 2
+					 && src.componentCount <= 4 && simd::hasSSE41())
+			{
+				doneElements = withIntegerType(src.componentType, [&](auto type) {
+					return stridedToUIntSSE41<decltype(type)::value>(src, dst);
+				});
+			}
+		}
+#endif
+		convertRemaining(src, dst, dstStride, doneElements, doneValues);
+	}
+
+	void convert(const Components &src, uint16_t *dst, size_t dstStride)
+	{
+		const bool packed = isPacked(src, dstStride);
+		if (packed && src.componentType == ComponentType::UNSIGNED_SHORT)
+		{
+			std::memcpy(dst, src.data, src.count * src.componentCount * sizeof(uint16_t));
+			return;
+		}
+
+		size_t doneValues = 0;
+#ifdef BOILER_GLTF_X86
+		const size_t total = src.count * src.componentCount;
+		if (packed && src.componentType == ComponentType::UNSIGNED_BYTE)
+		{
+			if (simd::hasAVX2())
+			{
+				doneValues = packedBytesToUShortAVX2(src.data, dst, total);
+			}
+			else if (simd::hasSSE41())
+			{
+				doneValues = packedBytesToUShortSSE41(src.data, dst, total);
+			}
+		}
+		else if (packed && src.componentType == ComponentType::UNSIGNED_INT)
+		{
+			if (simd::hasAVX2())
+			{
+				doneValues = packedUIntToUShortAVX2(src.data, dst, total);
+			}
+			else if (simd::hasSSE41())
+			{
+				doneValues = packedUIntToUShortSSE41(src.data, dst, total);
+			}
+		}
+#endif
+		convertRemaining(src, dst, dstStride, 0, doneValues);
+	}
+}}}
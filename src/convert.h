@@ -0,0 +1,103 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "gltf.h"
+
+namespace Boiler { namespace gltf { namespace convert
+{
+	// A run of count elements, each componentCount components of componentType,
+	// starting at data and spaced stride bytes apart.
+	struct Components
+	{
+		const std::byte *data;
+		size_t count;
+		size_t stride;
+		unsigned int componentCount;
+		ComponentType componentType;
+		bool normalized;
+	};
+
+	template<typename Source>
+	inline Source load(const std::byte *data)
+	{
+		// buffer data is only guaranteed to be aligned to the component size
+		Source value;
+		std::memcpy(&value, data, sizeof(Source));
+		return value;
+	}
+
+	// glTF's mapping of normalized integers to [0, 1] or [-1, 1]
+	template<typename Source>
+	inline float normalize(Source value)
+	{
+		if constexpr (std::is_same_v<Source, float>)
+		{
+			return value;
+		}
+		else if constexpr (std::is_signed_v<Source>)
+		{
+			return std::max(static_cast<float>(value) / std::numeric_limits<Source>::max(), -1.0f);
+		}
+		else
+		{
+			return static_cast<float>(value) / std::numeric_limits<Source>::max();
+		}
+	}
+
+	template<typename Source, typename T>
+	void convertComponents(const Components &src, T *dst, size_t dstStride)
+	{
+		const std::byte *element = src.data;
+		for (size_t i = 0; i < src.count; ++i, element += src.stride, dst += dstStride)
+		{
+			for (unsigned int c = 0; c < src.componentCount; ++c)
+			{
+				const Source value = load<Source>(element + c * sizeof(Source));
+				if constexpr (std::is_floating_point_v<T>)
+				{
+					dst[c] = static_cast<T>(src.normalized ? normalize(value) : static_cast<float>(value));
+				}
+				else
+				{
+					dst[c] = static_cast<T>(value);
+				}
+			}
+		}
+	}
+
+	// Reference conversion into any arithmetic type. Normalization only applies
+	// to floating point destinations. Element i lands at dst + i * dstStride.
+	template<typename T>
+	void convertScalar(const Components &src, T *dst, size_t dstStride)
+	{
+		switch (src.componentType)
+		{
+			case ComponentType::BYTE: convertComponents<int8_t>(src, dst, dstStride); break;
+			case ComponentType::UNSIGNED_BYTE: convertComponents<uint8_t>(src, dst, dstStride); break;
+			case ComponentType::SHORT: convertComponents<int16_t>(src, dst, dstStride); break;
+			case ComponentType::UNSIGNED_SHORT: convertComponents<uint16_t>(src, dst, dstStride); break;
+			case ComponentType::UNSIGNED_INT: convertComponents<uint32_t>(src, dst, dstStride); break;
+			case ComponentType::FLOAT: convertComponents<float>(src, dst, dstStride); break;
+		}
+	}
+
+	// Vectorized conversions for the common cases, falling back to
+	// convertScalar for everything else.
+	void convert(const Components &src, float *dst, size_t dstStride);
+	void convert(const Components &src, uint32_t *dst, size_t dstStride);
+	// unsigned bytes and ints to 16 bits, for index buffers
+	void convert(const Components &src, uint16_t *dst, size_t dstStride);
+
+	template<typename T>
+	void convert(const Components &src, T *dst, size_t dstStride)
+	{
+		convertScalar(src, dst, dstStride);
+	}
+}}}
+
+#endif /* CONVERT_H */
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <stdexcept>
 #include "gltf.h"
+#include "base64.h"
+#include "loadstats.h"
 
 namespace Boiler { namespace gltf
 {
@@ -8,11 +13,125 @@ namespace Boiler { namespace gltf
 		const static std::string NAME("name");
 	};
 
-	std::string getString(const Value &value, const std::string &key, const std::string &defaultValue) 
+	namespace glb
+	{
+		constexpr uint32_t MAGIC = 0x46546C67; // "glTF"
+		constexpr uint32_t VERSION = 2;
+		constexpr uint32_t CHUNK_JSON = 0x4E4F534A; // "JSON"
+		constexpr uint32_t CHUNK_BIN = 0x004E4942; // "BIN\0"
+		constexpr size_t HEADER_SIZE = 12;
+		constexpr size_t CHUNK_HEADER_SIZE = 8;
+
+		// GLB is little-endian and chunk data is only 4-byte aligned
+		uint32_t readUInt32(const std::byte *data)
+		{
+			uint32_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+	};
+
+	namespace
+	{
+		constexpr std::string_view attributeNames[] = {
+			"POSITION", "NORMAL", "TANGENT",
+			"TEXCOORD_0", "TEXCOORD_1", "TEXCOORD_2", "TEXCOORD_3",
+			"COLOR_0", "COLOR_1",
+			"JOINTS_0", "JOINTS_1",
+			"WEIGHTS_0", "WEIGHTS_1"
+		};
+		static_assert(std::size(attributeNames) == static_cast<size_t>(Attribute::ATTRIBUTE_COUNT));
+	}
+
+	std::string_view attributeName(Attribute attribute)
+	{
+		return attribute < Attribute::ATTRIBUTE_COUNT ? attributeNames[static_cast<size_t>(attribute)] : "";
+	}
+
+	Attribute parseAttribute(std::string_view name)
+	{
+		// custom attributes start with an underscore, semantics with a capital
+		if (name.empty() || name[0] == '_')
+		{
+			return Attribute::ATTRIBUTE_COUNT;
+		}
+		for (size_t i = 0; i < std::size(attributeNames); ++i)
+		{
+			if (attributeNames[i] == name)
+			{
+				return static_cast<Attribute>(i);
+			}
+		}
+		return Attribute::ATTRIBUTE_COUNT;
+	}
+
+	std::optional<int> Attributes::find(std::string_view name) const
+	{
+		const Attribute attribute = parseAttribute(name);
+		if (attribute != Attribute::ATTRIBUTE_COUNT)
+		{
+			return find(attribute);
+		}
+		for (const auto &[otherName, accessor] : others)
+		{
+			if (otherName == name)
+			{
+				return accessor;
+			}
+		}
+		return std::nullopt;
+	}
+
+	int Attributes::at(Attribute attribute) const
+	{
+		const std::optional<int> accessor = find(attribute);
+		if (!accessor.has_value())
+		{
+			throw std::out_of_range("primitive has no " + std::string(attributeName(attribute)) + " attribute");
+		}
+		return accessor.value();
+	}
+
+	int Attributes::at(std::string_view name) const
+	{
+		const std::optional<int> accessor = find(name);
+		if (!accessor.has_value())
+		{
+			throw std::out_of_range("primitive has no " + std::string(name) + " attribute");
+		}
+		return accessor.value();
+	}
+
+	void Attributes::set(std::string_view name, int accessor)
+	{
+		const Attribute attribute = parseAttribute(name);
+		if (attribute != Attribute::ATTRIBUTE_COUNT)
+		{
+			set(attribute, accessor);
+			return;
+		}
+		for (auto &[otherName, otherAccessor] : others)
+		{
+			if (otherName == name)
+			{
+				otherAccessor = accessor;
+				return;
+			}
+		}
+		others.emplace_back(name, accessor);
+	}
+
+	size_t Attributes::size() const
+	{
+		return others.size() + std::count_if(slots.begin(), slots.end(), [](int accessor) { return accessor >= 0; });
+	}
+
+	std::string_view getString(const Value &value, const std::string &key, std::string_view defaultValue)
 	{
 		if (value.HasMember(key.c_str()))
 		{
-			return std::string(value[key.c_str()].GetString());
+			const Value &string = value[key.c_str()];
+			return std::string_view(string.GetString(), string.GetStringLength());
 		}
 		else
 		{
@@ -103,14 +222,30 @@ namespace Boiler { namespace gltf
 		return matTexture;
 	};
 
-	Model load(const std::string &gltfPath, const std::string &jsonData)
+	// loadInsitu, timed by phases, which load starts before copying the JSON
+	// so the copy counts towards PARSE
+	static Model loadTimed(const std::string &gltfPath, std::vector<char> jsonData, PhaseTimer &phases)
 	{
 		using namespace gltf;
 		Model model(gltfPath);
 
-		Document document;
-		document.Parse(jsonData.c_str());
-
+		// ParseInsitu reads up to the terminator
+		if (jsonData.empty() || jsonData.back() != '\0')
+		{
+			jsonData.push_back('\0');
+		}
+		auto text = std::make_shared<std::vector<char>>(std::move(jsonData));
+		model.storage.data = text;
+
+		// The DOM only lives for the duration of the load. Its values come from
+		// an arena seeded on the stack and grown in chunks sized to the
+		// document, which is released in one go when the load returns.
+		char initialChunk[16 * 1024];
+		MemoryPoolAllocator<> allocator(initialChunk, sizeof(initialChunk),
+										std::max<size_t>(RAPIDJSON_ALLOCATOR_DEFAULT_CHUNK_CAPACITY, text->size()));
+		Document document(&allocator);
+		document.ParseInsitu(text->data());
+		phases.end(LoadPhase::PARSE, text->size());
 
 		// asset info
 		assert(document.HasMember("asset") && document["asset"].IsObject());
@@ -118,6 +253,7 @@ namespace Boiler { namespace gltf
 		model.asset.version = getString(assetValue, "version");
 		model.asset.generator = getString(assetValue, "generator");
 		model.asset.copyright = getString(assetValue, "copyright");
+		phases.end(LoadPhase::ASSET, 1);
 
 		// scene data
 		if (document.HasMember("scene"))
@@ -139,6 +275,7 @@ namespace Boiler { namespace gltf
 				model.scenes.push_back(newScene);
 			}
 		}
+		phases.end(LoadPhase::SCENES, model.scenes.size());
 
 		// nodes data
 		if (document.HasMember("nodes"))
@@ -168,9 +305,11 @@ namespace Boiler { namespace gltf
 				{
 					newNode.mesh = node["mesh"].GetInt();
 				}
+				newNode.skin = getInt(node, "skin");
 				model.nodes.push_back(newNode);
 			}
 		}
+		phases.end(LoadPhase::NODES, model.nodes.size());
 
 		// meshes
 		assert(document.HasMember("meshes"));
@@ -194,7 +333,20 @@ namespace Boiler { namespace gltf
 					for (Value::ConstMemberIterator itr = attributes.MemberBegin();
 							itr != attributes.MemberEnd(); ++itr)
 					{
-						newPrimitive.attributes[itr->name.GetString()] = itr->value.GetInt();
+						newPrimitive.attributes.set(std::string_view(itr->name.GetString(), itr->name.GetStringLength()),
+													itr->value.GetInt());
+					}
+				}
+				if (primitive.HasMember("targets"))
+				{
+					for (const auto &target : primitive["targets"].GetArray())
+					{
+						auto &newTarget = newPrimitive.targets.emplace_back();
+						for (Value::ConstMemberIterator itr = target.MemberBegin(); itr != target.MemberEnd(); ++itr)
+						{
+							newTarget.set(std::string_view(itr->name.GetString(), itr->name.GetStringLength()),
+										  itr->value.GetInt());
+						}
 					}
 				}
 				newPrimitive.indices = getInt(primitive, "indices");
@@ -202,8 +354,17 @@ namespace Boiler { namespace gltf
 				newPrimitive.material = getInt(primitive, "material");
 				newMesh.primitives.push_back(newPrimitive);
 			}
+
+			if (mesh.HasMember("weights"))
+			{
+				for (const auto &weight : mesh["weights"].GetArray())
+				{
+					newMesh.weights.push_back(weight.GetFloat());
+				}
+			}
 			model.meshes.push_back(newMesh);
 		}
+		phases.end(LoadPhase::MESHES, model.meshes.size());
 
 		// accessors
 		assert(document.HasMember("accessors"));
@@ -215,7 +376,7 @@ namespace Boiler { namespace gltf
 			newAccessor.bufferView = getInt(accessor, "bufferView");
 
 			newAccessor.type = AccessorType::VEC3;
-			std::string accessorType = getString(accessor, "type");
+			const std::string_view accessorType = getString(accessor, "type");
 			if (accessorType == "SCALAR")
 			{
 				newAccessor.type = AccessorType::SCALAR;
@@ -251,6 +412,7 @@ namespace Boiler { namespace gltf
 				newAccessor.byteOffset = byteOffset.value();
 			}
 			newAccessor.componentType = static_cast<ComponentType>(accessor["componentType"].GetInt());
+			getBool(accessor, "normalized", newAccessor.normalized);
 			newAccessor.count = accessor["count"].GetInt();
 			newAccessor.name = getString(accessor, keys::NAME);
 
@@ -271,8 +433,25 @@ namespace Boiler { namespace gltf
 				}
 			}
 
+			if (accessor.HasMember("sparse"))
+			{
+				const auto &sparse = accessor["sparse"];
+				const auto &indices = sparse["indices"];
+				const auto &values = sparse["values"];
+
+				Sparse newSparse;
+				newSparse.count = sparse["count"].GetInt();
+				newSparse.indices.bufferView = indices["bufferView"].GetInt();
+				newSparse.indices.byteOffset = getInt(indices, "byteOffset").value_or(0);
+				newSparse.indices.componentType = static_cast<ComponentType>(indices["componentType"].GetInt());
+				newSparse.values.bufferView = values["bufferView"].GetInt();
+				newSparse.values.byteOffset = getInt(values, "byteOffset").value_or(0);
+				newAccessor.sparse = newSparse;
+			}
+
 			model.accessors.push_back(newAccessor);
 		}
+		phases.end(LoadPhase::ACCESSORS, model.accessors.size());
 
 		// buffers
 		assert(document.HasMember("buffers"));
@@ -286,6 +465,7 @@ namespace Boiler { namespace gltf
 
 			model.buffers.push_back(newBuffer);
 		}
+		phases.end(LoadPhase::BUFFERS, model.buffers.size());
 
 		// buffer views
 		assert(document.HasMember("bufferViews"));
@@ -307,6 +487,7 @@ namespace Boiler { namespace gltf
 
 			model.bufferViews.push_back(newBufferView);
 		}
+		phases.end(LoadPhase::BUFFER_VIEWS, model.bufferViews.size());
 
 		// materials
 		if (document.HasMember("materials") && document["materials"].IsArray())
@@ -347,6 +528,7 @@ namespace Boiler { namespace gltf
 				model.materials.push_back(newMaterial);
 			}
 		}
+		phases.end(LoadPhase::MATERIALS, model.materials.size());
 
 		// images
 		if (document.HasMember("images"))
@@ -365,6 +547,7 @@ namespace Boiler { namespace gltf
 				model.images.push_back(newImage);
 			}
 		}
+		phases.end(LoadPhase::IMAGES, model.images.size());
 
 		// textures
 		if (document.HasMember("textures"))
@@ -382,6 +565,7 @@ namespace Boiler { namespace gltf
 				model.textures.push_back(newTexture);
 			}
 		}
+		phases.end(LoadPhase::TEXTURES, model.textures.size());
 
 		// animations
 		if (document.HasMember("animations"))
@@ -402,7 +586,7 @@ namespace Boiler { namespace gltf
 
 					for (const auto &sampler : samplers)
 					{
-						const std::string interpStr = getString(sampler, "interpolation", "LINEAR");
+						const std::string_view interpStr = getString(sampler, "interpolation", "LINEAR");
 						Interpolation interpolation = Interpolation::LINEAR;
 						if (interpStr == "STEP")
 						{
@@ -433,7 +617,7 @@ namespace Boiler { namespace gltf
 						{
 							newTarget.node = target["node"].GetInt();
 						}
-						newTarget.path = target["path"].GetString();
+						newTarget.path = std::string_view(target["path"].GetString(), target["path"].GetStringLength());
 
 						newAnimation.channels.push_back(
 							Channel(channel["sampler"].GetInt(), newTarget));
@@ -442,29 +626,258 @@ namespace Boiler { namespace gltf
 				model.animations.push_back(newAnimation);
 			}
 		}
+		phases.end(LoadPhase::ANIMATIONS, model.animations.size());
+
+		// skins
+		if (document.HasMember("skins"))
+		{
+			const auto &skins = document["skins"].GetArray();
+			model.skins.reserve(skins.Size());
+
+			for (const auto &skin : skins)
+			{
+				Skin newSkin;
+				newSkin.name = getString(skin, keys::NAME);
+				newSkin.inverseBindMatrices = getInt(skin, "inverseBindMatrices");
+				newSkin.skeleton = getInt(skin, "skeleton");
+
+				assert(skin.HasMember("joints"));
+				for (const auto &joint : skin["joints"].GetArray())
+				{
+					newSkin.joints.push_back(joint.GetInt());
+				}
+				model.skins.push_back(newSkin);
+			}
+		}
+		phases.end(LoadPhase::SKINS, model.skins.size());
 
 		return model;
 	}
 
+	std::string_view InternedStrings::add(std::string text)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return strings.emplace_back(std::move(text));
+	}
+
+	std::string_view Model::intern(std::string text)
+	{
+		if (!storage.strings)
+		{
+			storage.strings = std::make_shared<InternedStrings>();
+		}
+		return storage.strings->add(std::move(text));
+	}
+
+	Model load(const std::string &gltfPath, std::string_view jsonData, LoadObserver *observer)
+	{
+		PhaseTimer phases(observer);
+		std::vector<char> text;
+		text.reserve(jsonData.size() + 1);
+		text.assign(jsonData.begin(), jsonData.end());
+		return loadTimed(gltfPath, std::move(text), phases);
+	}
+
+	Model loadInsitu(const std::string &gltfPath, std::vector<char> jsonData, LoadObserver *observer)
+	{
+		PhaseTimer phases(observer);
+		return loadTimed(gltfPath, std::move(jsonData), phases);
+	}
+
+	std::optional<GLBChunks> parseGLB(ByteSpan glbData)
+	{
+		if (glbData.size() < glb::HEADER_SIZE + glb::CHUNK_HEADER_SIZE
+			|| glb::readUInt32(glbData.data()) != glb::MAGIC
+			|| glb::readUInt32(glbData.data() + 4) != glb::VERSION)
+		{
+			return std::nullopt;
+		}
+
+		// the header length is authoritative, trailing bytes are ignored
+		const size_t length = glb::readUInt32(glbData.data() + 8);
+		if (length > glbData.size())
+		{
+			return std::nullopt;
+		}
+		glbData = glbData.first(length);
+
+		GLBChunks chunks;
+		bool hasJson = false;
+		size_t offset = glb::HEADER_SIZE;
+		while (offset + glb::CHUNK_HEADER_SIZE <= glbData.size())
+		{
+			const size_t chunkLength = glb::readUInt32(glbData.data() + offset);
+			const uint32_t chunkType = glb::readUInt32(glbData.data() + offset + 4);
+			offset += glb::CHUNK_HEADER_SIZE;
+			if (chunkLength > glbData.size() - offset)
+			{
+				return std::nullopt;
+			}
+
+			const ByteSpan chunkData = glbData.subspan(offset, chunkLength);
+			if (!hasJson)
+			{
+				// the JSON chunk must come first
+				if (chunkType != glb::CHUNK_JSON)
+				{
+					return std::nullopt;
+				}
+				chunks.json = std::string_view(reinterpret_cast<const char *>(chunkData.data()), chunkData.size());
+				hasJson = true;
+			}
+			else if (chunkType == glb::CHUNK_BIN && chunks.bin.empty())
+			{
+				chunks.bin = chunkData;
+			}
+			// unknown chunk types must be skipped
+
+			offset += chunkLength;
+		}
+
+		if (!hasJson)
+		{
+			return std::nullopt;
+		}
+		return chunks;
+	}
+
+	std::optional<GLB> loadGLB(const std::string &gltfPath, ByteSpan glbData, LoadObserver *observer)
+	{
+		const std::optional<GLBChunks> chunks = parseGLB(glbData);
+		if (!chunks.has_value())
+		{
+			return std::nullopt;
+		}
+		return GLB{load(gltfPath, chunks->json, observer), chunks->bin};
+	}
+
+	std::optional<DataUri> parseDataUri(std::string_view uri)
+	{
+		constexpr std::string_view scheme("data:");
+		if (uri.substr(0, scheme.size()) != scheme)
+		{
+			return std::nullopt;
+		}
+		uri.remove_prefix(scheme.size());
+
+		const size_t comma = uri.find(',');
+		if (comma == std::string_view::npos)
+		{
+			return std::nullopt;
+		}
+
+		DataUri dataUri;
+		std::string_view mediaType = uri.substr(0, comma);
+		dataUri.data = uri.substr(comma + 1);
+
+		constexpr std::string_view base64Suffix(";base64");
+		dataUri.base64 = mediaType.size() >= base64Suffix.size()
+			&& mediaType.substr(mediaType.size() - base64Suffix.size()) == base64Suffix;
+		if (dataUri.base64)
+		{
+			mediaType.remove_suffix(base64Suffix.size());
+		}
+		dataUri.mimeType = mediaType.substr(0, mediaType.find(';'));
+
+		return dataUri;
+	}
+
+	namespace
+	{
+		// decodes the payload straight into output, which is resized to fit
+		bool decodeDataUri(const DataUri &dataUri, std::vector<std::byte> &output)
+		{
+			if (!dataUri.base64)
+			{
+				// percent-encoded payloads aren't produced by glTF exporters
+				return false;
+			}
+
+			output.resize(base64::decodedSize(dataUri.data));
+			const std::optional<size_t> written = base64::decode(dataUri.data, output);
+			if (!written.has_value())
+			{
+				return false;
+			}
+			output.resize(written.value());
+			return true;
+		}
+
+		bool readFile(const std::filesystem::path &path, std::vector<std::byte> &output, std::optional<size_t> length)
+		{
+			std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+			if (!ifs)
+			{
+				return false;
+			}
+
+			const size_t size = length.has_value() ? length.value() : static_cast<size_t>(ifs.tellg());
+			output.resize(size);
+			ifs.seekg(0);
+			return static_cast<bool>(ifs.read(reinterpret_cast<char *>(output.data()), size));
+		}
+	}
+
+	std::optional<std::vector<std::byte>> decodeDataUri(std::string_view uri)
+	{
+		const std::optional<DataUri> dataUri = parseDataUri(uri);
+		std::vector<std::byte> bytes;
+		if (!dataUri.has_value() || !decodeDataUri(dataUri.value(), bytes))
+		{
+			return std::nullopt;
+		}
+		return bytes;
+	}
+
+	std::optional<std::vector<std::byte>> loadImage(const std::string &basePath, const Image &image)
+	{
+		std::vector<std::byte> bytes;
+		if (const std::optional<DataUri> dataUri = parseDataUri(image.uri))
+		{
+			if (!decodeDataUri(dataUri.value(), bytes))
+			{
+				return std::nullopt;
+			}
+		}
+		else if (image.uri.empty() || !readFile(std::filesystem::path(basePath) / image.uri, bytes, std::nullopt))
+		{
+			// images stored in a bufferView are read through ModelAccessors
+			return std::nullopt;
+		}
+		return bytes;
+	}
+
 	std::vector<std::byte> loadBuffer(const std::string &basePath, const Buffer &buffer)
 	{
 		std::vector<std::byte> dataBuffer;
-		dataBuffer.resize(buffer.byteLength);
+		if (const std::optional<DataUri> dataUri = parseDataUri(buffer.uri))
+		{
+			if (!decodeDataUri(dataUri.value(), dataBuffer))
+			{
+				dataBuffer.clear();
+			}
+			// a short payload is kept as is for validate() to report
+			dataBuffer.resize(std::min<size_t>(dataBuffer.size(), buffer.byteLength));
+			return dataBuffer;
+		}
 
 		std::filesystem::path bufferPath(basePath);
 		bufferPath.append(buffer.uri);
 
 		std::ifstream ifs(bufferPath, std::ios::binary);
-		if (ifs)
+		if (!ifs)
 		{
-			ifs.seekg(0);
-			if(!ifs.read(reinterpret_cast<char *>(dataBuffer.data()), buffer.byteLength))
-			{
-				exit(1);
-			}
-			ifs.close();
+			// empty rather than zero filled, so validate() reports it missing
+			return dataBuffer;
 		}
 
+		dataBuffer.resize(buffer.byteLength);
+		ifs.seekg(0);
+		ifs.read(reinterpret_cast<char *>(dataBuffer.data()), buffer.byteLength);
+		// only the bytes the file had, so validate() reports it too short
+		dataBuffer.resize(static_cast<size_t>(ifs.gcount()));
+		ifs.close();
+
 		return dataBuffer;
 	}
 };
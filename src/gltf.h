@@ -2,11 +2,17 @@
 #define GLTF_H
 
 #include <array>
+#include <cstdint>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <optional>
+#include <span>
+#include <string_view>
 #include <unordered_map>
 #include <rapidjson/document.h>
 
@@ -15,6 +21,8 @@ using namespace rapidjson;
 namespace Boiler { namespace gltf
 {
 
+class LoadObserver;
+
 using floatArray3 = std::array<float, 3>;
 using floatArray4 = std::array<float, 4>;
 using floatArray16 = std::array<float, 16>;
@@ -23,14 +31,19 @@ namespace attributes
 {
     static inline const std::string POSITION = "POSITION";
     static inline const std::string NORMAL = "NORMAL";
+    static inline const std::string TANGENT = "TANGENT";
     static inline const std::string TEXCOORD_0 = "TEXCOORD_0";
+    static inline const std::string JOINTS_0 = "JOINTS_0";
+    static inline const std::string WEIGHTS_0 = "WEIGHTS_0";
 }
 
 struct GLTFBase
 {
+    bool operator==(const GLTFBase &) const = default;
 };
 
 using byte_size = unsigned int;
+using ByteSpan = std::span<const std::byte>;
 
 union AccessorValue
 {
@@ -45,6 +58,11 @@ union AccessorValue
     {
         this->asFloat = value;
     }
+
+    bool operator==(const AccessorValue &other) const
+    {
+        return asUnsignedInt == other.asUnsignedInt;
+    }
 };
 
 enum class ComponentType
@@ -68,6 +86,83 @@ enum class AccessorType
 	MAT4
 };
 
+constexpr unsigned int componentSize(ComponentType componentType)
+{
+    switch (componentType)
+    {
+        case ComponentType::BYTE:
+        case ComponentType::UNSIGNED_BYTE:
+            return 1;
+        case ComponentType::SHORT:
+        case ComponentType::UNSIGNED_SHORT:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+constexpr unsigned int componentCount(AccessorType type)
+{
+    switch (type)
+    {
+        case AccessorType::SCALAR: return 1;
+        case AccessorType::VEC2: return 2;
+        case AccessorType::VEC3: return 3;
+        case AccessorType::VEC4: return 4;
+        case AccessorType::MAT2: return 4;
+        case AccessorType::MAT3: return 9;
+        case AccessorType::MAT4: return 16;
+    }
+    return 1;
+}
+
+// matrices are stored column by column, everything else is a single column
+constexpr unsigned int columnCount(AccessorType type)
+{
+    switch (type)
+    {
+        case AccessorType::MAT2: return 2;
+        case AccessorType::MAT3: return 3;
+        case AccessorType::MAT4: return 4;
+        default: return 1;
+    }
+}
+
+// Matrix columns start on 4-byte boundaries, which pads MAT2/MAT3 columns of
+// 1-byte and MAT3 columns of 2-byte components.
+constexpr unsigned int columnSize(ComponentType componentType, AccessorType type)
+{
+    const unsigned int size = componentCount(type) / columnCount(type) * componentSize(componentType);
+    return columnCount(type) > 1 ? (size + 3) & ~3u : size;
+}
+
+constexpr unsigned int elementSize(ComponentType componentType, AccessorType type)
+{
+    return columnSize(componentType, type) * columnCount(type);
+}
+
+// The component type whose values are stored as T, for the types accessors
+// read components as.
+template<typename T>
+struct ComponentTypeOf;
+template<> struct ComponentTypeOf<int8_t> { static constexpr ComponentType value = ComponentType::BYTE; };
+template<> struct ComponentTypeOf<uint8_t> { static constexpr ComponentType value = ComponentType::UNSIGNED_BYTE; };
+template<> struct ComponentTypeOf<int16_t> { static constexpr ComponentType value = ComponentType::SHORT; };
+template<> struct ComponentTypeOf<uint16_t> { static constexpr ComponentType value = ComponentType::UNSIGNED_SHORT; };
+template<> struct ComponentTypeOf<uint32_t> { static constexpr ComponentType value = ComponentType::UNSIGNED_INT; };
+template<> struct ComponentTypeOf<float> { static constexpr ComponentType value = ComponentType::FLOAT; };
+
+// The narrowest index type for vertexCount vertices. The largest value of
+// each type is reserved for primitive restart, so it can't be an index.
+constexpr ComponentType indexComponentType(size_t vertexCount)
+{
+    if (vertexCount <= 0xff)
+    {
+        return ComponentType::UNSIGNED_BYTE;
+    }
+    return vertexCount <= 0xffff ? ComponentType::UNSIGNED_SHORT : ComponentType::UNSIGNED_INT;
+}
+
 enum class Interpolation
 {
     LINEAR,
@@ -75,6 +170,52 @@ enum class Interpolation
     CUBICSPLINE
 };
 
+struct SparseIndices : GLTFBase
+{
+    byte_size bufferView;
+    byte_size byteOffset;
+    ComponentType componentType;
+
+    SparseIndices()
+    {
+        bufferView = 0;
+        byteOffset = 0;
+        componentType = ComponentType::UNSIGNED_INT;
+    }
+
+    bool operator==(const SparseIndices &) const = default;
+};
+
+struct SparseValues : GLTFBase
+{
+    byte_size bufferView;
+    byte_size byteOffset;
+
+    SparseValues()
+    {
+        bufferView = 0;
+        byteOffset = 0;
+    }
+
+    bool operator==(const SparseValues &) const = default;
+};
+
+// Elements replaced on top of the accessor's bufferView data (or zeros). The
+// indices are strictly increasing and the values tightly packed.
+struct Sparse : GLTFBase
+{
+    unsigned int count;
+    SparseIndices indices;
+    SparseValues values;
+
+    Sparse()
+    {
+        count = 0;
+    }
+
+    bool operator==(const Sparse &) const = default;
+};
+
 struct Accessor : GLTFBase
 {
     std::optional<byte_size> bufferView;
@@ -84,7 +225,8 @@ struct Accessor : GLTFBase
     unsigned int count;
     AccessorType type;
     std::vector<AccessorValue> max, min;
-    std::string name;
+    std::optional<Sparse> sparse;
+    std::string_view name; // in Model::storage, see Model::intern
 
     Accessor()
     {
@@ -94,6 +236,8 @@ struct Accessor : GLTFBase
         count = 0;
         type = AccessorType::SCALAR;
     }
+
+    bool operator==(const Accessor &) const = default;
 };
 
 struct BufferView : GLTFBase
@@ -103,29 +247,35 @@ struct BufferView : GLTFBase
     std::optional<byte_size> byteLength;
     std::optional<byte_size> byteStride;
     std::optional<int> target;
-    std::string name;
+    std::string_view name; // in Model::storage, see Model::intern
 
     BufferView()
     {
         byteOffset = 0;
     }
+
+    bool operator==(const BufferView &) const = default;
 };
 
 struct Buffer : GLTFBase
 {
-    std::string uri;
+    std::string_view uri; // in Model::storage, see Model::intern
     byte_size byteLength;
-    std::string name;
+    std::string_view name; // in Model::storage, see Model::intern
 
     Buffer(byte_size byteLength)
     {
         this->byteLength = byteLength;
     }
+
+    bool operator==(const Buffer &) const = default;
 };
 
 struct Asset : GLTFBase
 {
-    std::string version, generator, copyright;
+    std::string_view version, generator, copyright; // in Model::storage, see Model::intern
+
+    bool operator==(const Asset &) const = default;
 };
 
 struct Node : GLTFBase
@@ -133,44 +283,172 @@ struct Node : GLTFBase
     std::vector<int> children;
     std::optional<floatArray16> matrix;
     std::optional<int> mesh;
+    std::optional<int> skin;
     std::optional<floatArray4> rotation;
     std::optional<floatArray3> scale;
     std::optional<floatArray3> translation;
-    std::string name;
+    std::string_view name; // in Model::storage, see Model::intern
+
+    bool operator==(const Node &) const = default;
 };
 
 struct Scene : GLTFBase
 {
     std::vector<int> nodes;
+
+    bool operator==(const Scene &) const = default;
+};
+
+// Vertex attribute semantics that have a slot of their own in Attributes.
+enum class Attribute : uint8_t
+{
+    POSITION,
+    NORMAL,
+    TANGENT,
+    TEXCOORD_0,
+    TEXCOORD_1,
+    TEXCOORD_2,
+    TEXCOORD_3,
+    COLOR_0,
+    COLOR_1,
+    JOINTS_0,
+    JOINTS_1,
+    WEIGHTS_0,
+    WEIGHTS_1,
+    ATTRIBUTE_COUNT
+};
+
+std::string_view attributeName(Attribute attribute);
+// the semantic named, ATTRIBUTE_COUNT for names without a slot
+Attribute parseAttribute(std::string_view name);
+
+// The accessors of a primitive's or morph target's attributes. Semantics
+// with a slot are looked up by indexing an inline array. Everything else,
+// "_" prefixed custom attributes and sets past the slots such as
+// TEXCOORD_4, goes in a side table that is searched by name. Like the rest
+// of the model's strings, side table names are views into Model::storage.
+class Attributes
+{
+    static constexpr size_t SLOT_COUNT = static_cast<size_t>(Attribute::ATTRIBUTE_COUNT);
+
+    // accessor indices, -1 where absent
+    std::array<int, SLOT_COUNT> slots;
+    std::vector<std::pair<std::string_view, int>> others;
+
+public:
+    class const_iterator
+    {
+        const Attributes *attributes;
+        size_t position;
+
+        void skipEmpty()
+        {
+            while (position < SLOT_COUNT && attributes->slots[position] < 0)
+            {
+                ++position;
+            }
+        }
+
+    public:
+        using value_type = std::pair<std::string_view, int>;
+        using difference_type = std::ptrdiff_t;
+
+        const_iterator() : attributes(nullptr), position(0) {}
+        const_iterator(const Attributes *attributes, size_t position) : attributes(attributes), position(position)
+        {
+            skipEmpty();
+        }
+
+        // the name and accessor index
+        value_type operator*() const
+        {
+            if (position < SLOT_COUNT)
+            {
+                return {attributeName(static_cast<Attribute>(position)), attributes->slots[position]};
+            }
+            return attributes->others[position - SLOT_COUNT];
+        }
+
+        const_iterator &operator++() { ++position; skipEmpty(); return *this; }
+        const_iterator operator++(int) { const_iterator previous = *this; ++*this; return previous; }
+        bool operator==(const const_iterator &other) const { return position == other.position; }
+    };
+
+    Attributes()
+    {
+        slots.fill(-1);
+    }
+
+    std::optional<int> find(Attribute attribute) const
+    {
+        const int accessor = slots[static_cast<size_t>(attribute)];
+        return accessor >= 0 ? std::optional<int>(accessor) : std::nullopt;
+    }
+    std::optional<int> find(std::string_view name) const;
+
+    // like find, but throws std::out_of_range if the attribute is absent
+    int at(Attribute attribute) const;
+    int at(std::string_view name) const;
+
+    bool contains(Attribute attribute) const { return slots[static_cast<size_t>(attribute)] >= 0; }
+    bool contains(std::string_view name) const { return find(name).has_value(); }
+
+    void set(Attribute attribute, int accessor) { slots[static_cast<size_t>(attribute)] = accessor; }
+    // name must stay valid as long as the model, unless it has a slot;
+    // pass model.intern(name) for a string the caller doesn't keep
+    void set(std::string_view name, int accessor);
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, SLOT_COUNT + others.size()); }
+
+    // side table entries, for serializing
+    const std::vector<std::pair<std::string_view, int>> &customAttributes() const { return others; }
+
+    bool operator==(const Attributes &) const = default;
 };
 
 struct Primitive : GLTFBase
 {
-    std::unordered_map<std::string, int> attributes;
+    Attributes attributes;
+    // morph targets: POSITION, NORMAL and TANGENT deltas
+    std::vector<Attributes> targets;
     std::optional<int> indices;
     std::optional<int> material;
     std::optional<int> mode;
+
+    bool operator==(const Primitive &) const = default;
 };
 
 struct Mesh : GLTFBase
 {
-    std::string name;
+    std::string_view name; // in Model::storage, see Model::intern
     std::vector<Primitive> primitives;
+    // default morph target weights
+    std::vector<float> weights;
+
+    bool operator==(const Mesh &) const = default;
 };
 
 struct Image : GLTFBase
 {
-    std::string uri;
-    std::string mimeType;
+    std::string_view uri; // in Model::storage, see Model::intern
+    std::string_view mimeType; // in Model::storage, see Model::intern
     std::optional<int> bufferView;
-    std::string name;
+    std::string_view name; // in Model::storage, see Model::intern
+
+    bool operator==(const Image &) const = default;
 };
 
 struct Texture : GLTFBase
 {
     std::optional<int> sampler;
     std::optional<int> source;
-    std::string name;
+    std::string_view name; // in Model::storage, see Model::intern
+
+    bool operator==(const Texture &) const = default;
 };
 
 struct MaterialTexture : GLTFBase
@@ -183,6 +461,8 @@ struct MaterialTexture : GLTFBase
     {
         scale = 1.0f;
     }
+
+    bool operator==(const MaterialTexture &) const = default;
 };
 
 struct PBRMetallicRoughness : GLTFBase
@@ -199,17 +479,19 @@ struct PBRMetallicRoughness : GLTFBase
         metallicFactor = 1;
         roughnessFactor = 1;
     }
+
+    bool operator==(const PBRMetallicRoughness &) const = default;
 };
 
 struct Material : GLTFBase
 {
-    std::string name;
+    std::string_view name; // in Model::storage, see Model::intern
     std::optional<PBRMetallicRoughness> pbrMetallicRoughness;
     std::optional<MaterialTexture> normalTexture;
     std::optional<MaterialTexture> occlusionTexture;
     std::optional<MaterialTexture> emissiveTexture;
     std::optional<floatArray3> emissiveFactor;
-    std::string alphaMode;
+    std::string_view alphaMode; // in Model::storage, see Model::intern
     float alphaCutoff;
     bool doubleSided;
 
@@ -220,12 +502,16 @@ struct Material : GLTFBase
         alphaCutoff = 0.5f;
         doubleSided = false;
     }
+
+    bool operator==(const Material &) const = default;
 };
 
 struct Target : GLTFBase
 {
     std::optional<unsigned int>node;
-    std::string path;
+    std::string_view path; // in Model::storage, see Model::intern
+
+    bool operator==(const Target &) const = default;
 };
 
 struct Sampler : GLTFBase
@@ -240,6 +526,8 @@ struct Sampler : GLTFBase
         this->output = output;
         this->interpolation = interpolation;
     }
+
+    bool operator==(const Sampler &) const = default;
 };
 
 struct Channel : GLTFBase
@@ -251,18 +539,58 @@ struct Channel : GLTFBase
     {
 		this->sampler = sampler;
     }
+
+    bool operator==(const Channel &) const = default;
 };
 
 struct Animation : GLTFBase
 {
-    std::string name;
+    std::string_view name; // in Model::storage, see Model::intern
     std::vector<Channel> channels;
     std::vector<Sampler> samplers;
+
+    bool operator==(const Animation &) const = default;
+};
+
+struct Skin : GLTFBase
+{
+    std::optional<int> inverseBindMatrices;
+    std::optional<int> skeleton;
+    std::vector<int> joints;
+    std::string_view name; // in Model::storage, see Model::intern
+
+    bool operator==(const Skin &) const = default;
+};
+
+// Strings a model owns itself rather than viewing in its source, see
+// Model::intern. Never moved once added, and safe to add to from any thread.
+class InternedStrings
+{
+    std::mutex mutex;
+    std::deque<std::string> strings;
+
+public:
+    std::string_view add(std::string text);
+};
+
+// Keeps the memory that a model's string views point into alive: the JSON
+// text parsed in place, or the baked blob, and any strings interned since.
+// Copies of a model share it. Ignored when comparing models.
+struct ModelStorage
+{
+    std::shared_ptr<const void> data;
+    std::shared_ptr<InternedStrings> strings;
+
+    bool operator==(const ModelStorage &) const
+    {
+        return true;
+    }
 };
 
 struct Model : GLTFBase
 {
     const std::string gltfPath;
+    ModelStorage storage;
 
     Asset asset;
     int scene;
@@ -276,17 +604,69 @@ struct Model : GLTFBase
     std::vector<Image> images;
     std::vector<Texture> textures;
     std::vector<Animation> animations;
+    std::vector<Skin> skins;
 
     Model(const std::string &gltfPath) : gltfPath(gltfPath)
     {
         scene = 0;
     }
+
+    // Every string field of the model is a view that must stay valid as
+    // long as the model. Strings not loaded with it, e.g. names set on a
+    // model built by hand, are copied in here and stay valid as long as the
+    // model or any copy of it: mesh.name = model.intern(name).
+    std::string_view intern(std::string text);
+
+    bool operator==(const Model &) const = default;
+};
+
+// Views into a binary glTF (.glb) container. Both point into the memory
+// passed to parseGLB, nothing is copied.
+struct GLBChunks
+{
+    std::string_view json;
+    ByteSpan bin;
+};
+
+// The parts of a "data:[<mediatype>][;base64],<data>" uri, viewing the uri.
+struct DataUri
+{
+    std::string_view mimeType;
+    std::string_view data;
+    bool base64;
+};
+
+// A model loaded from a .glb container. The first buffer of a GLB model has no
+// uri and refers to the BIN chunk, which is exposed in place.
+struct GLB
+{
+    Model model;
+    ByteSpan bin;
 };
 
-std::string getString(const Value &value, const std::string &key, const std::string &defaultValue = "");
+std::string_view getString(const Value &value, const std::string &key, std::string_view defaultValue = "");
 std::optional<int> getInt(const Value &value, const std::string &key);
-Model load(const std::string &gltfPath, const std::string &jsonData);
+// Copies the JSON and loads it in place, see loadInsitu. An observer, if
+// given, is told how long each section of the document took, see loadstats.h.
+Model load(const std::string &gltfPath, std::string_view jsonData, LoadObserver *observer = nullptr);
+// Parses jsonData in place and keeps it alive in model.storage. All strings in
+// the returned model are views into it, so loading allocates no strings and
+// dropping the model frees them in one go.
+Model loadInsitu(const std::string &gltfPath, std::vector<char> jsonData, LoadObserver *observer = nullptr);
+// Single-pass SAX loader that fills the model without building a DOM. Produces
+// the same model as load(), returns nullopt if the JSON is malformed. Sections
+// are read interleaved, so an observer sees one PARSE phase.
+std::optional<Model> loadStreaming(const std::string &gltfPath, std::string_view jsonData,
+                                   LoadObserver *observer = nullptr);
+std::optional<GLBChunks> parseGLB(ByteSpan glbData);
+std::optional<GLB> loadGLB(const std::string &gltfPath, ByteSpan glbData, LoadObserver *observer = nullptr);
+std::optional<DataUri> parseDataUri(std::string_view uri);
+std::optional<std::vector<std::byte>> decodeDataUri(std::string_view uri);
+// Returns an empty buffer if the file can't be opened or the data uri can't be
+// decoded, and only the bytes there were if there are fewer than byteLength.
+// See readBuffer for one that reports errors.
 std::vector<std::byte> loadBuffer(const std::string &basePath, const Buffer &buffer);
+std::optional<std::vector<std::byte>> loadImage(const std::string &basePath, const Image &image);
 
 };
 };
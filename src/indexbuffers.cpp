@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cstring>
+#include "convert.h"
+#include "indexbuffers.h"
+#include "modelaccessors.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	template<typename T>
+	void encode(std::span<const uint32_t> indices, std::vector<std::byte> &out)
+	{
+		out.resize(indices.size() * sizeof(T));
+		const convert::Components src{reinterpret_cast<const std::byte *>(indices.data()), indices.size(),
+									  sizeof(uint32_t), 1, ComponentType::UNSIGNED_INT, false};
+		// out is only aligned for bytes, so 16 and 32 bits go through a copy
+		std::vector<T> values(indices.size());
+		convert::convert(src, values.data(), 1);
+		std::memcpy(out.data(), values.data(), out.size());
+	}
+
+	// references to each bufferView from accessors, sparse storage and images
+	std::vector<unsigned int> countViewUses(const Model &model)
+	{
+		std::vector<unsigned int> uses(model.bufferViews.size(), 0);
+		const auto use = [&](size_t view)
+		{
+			if (view < uses.size())
+			{
+				++uses[view];
+			}
+		};
+		for (const Accessor &accessor : model.accessors)
+		{
+			if (accessor.bufferView.has_value())
+			{
+				use(accessor.bufferView.value());
+			}
+			if (accessor.sparse.has_value())
+			{
+				use(accessor.sparse->indices.bufferView);
+				use(accessor.sparse->values.bufferView);
+			}
+		}
+		for (const Image &image : model.images)
+		{
+			if (image.bufferView.has_value() && image.bufferView.value() >= 0)
+			{
+				use(image.bufferView.value());
+			}
+		}
+		return uses;
+	}
+
+	// an index accessor's indices, read before its view is rewritten
+	struct IndexData
+	{
+		size_t accessor;
+		std::vector<uint32_t> indices;
+		// the type it will be written as
+		ComponentType type;
+	};
+}
+
+void Boiler::gltf::encodeIndices(std::span<const uint32_t> indices, ComponentType type, std::vector<std::byte> &out)
+{
+	switch (type)
+	{
+		case ComponentType::UNSIGNED_BYTE: encode<uint8_t>(indices, out); break;
+		case ComponentType::UNSIGNED_SHORT: encode<uint16_t>(indices, out); break;
+		default: encode<uint32_t>(indices, out); break;
+	}
+}
+
+IndexNarrowing Boiler::gltf::narrowIndices(Model &model, std::vector<std::vector<std::byte>> &buffers)
+{
+	IndexNarrowing narrowing;
+	std::vector<bool> isIndices(model.accessors.size(), false);
+	for (const Mesh &mesh : model.meshes)
+	{
+		for (const Primitive &primitive : mesh.primitives)
+		{
+			if (primitive.indices.has_value() && primitive.indices.value() >= 0
+				&& static_cast<size_t>(primitive.indices.value()) < isIndices.size())
+			{
+				isIndices[primitive.indices.value()] = true;
+			}
+		}
+	}
+
+	// every readable index accessor, grouped by bufferView; strided views
+	// aren't valid for indices and are left alone
+	const ModelAccessors accessors(model, buffers);
+	std::vector<std::vector<IndexData>> views(model.bufferViews.size());
+	for (size_t a = 0; a < model.accessors.size(); ++a)
+	{
+		const Accessor &accessor = model.accessors[a];
+		if (!isIndices[a] || !accessor.bufferView.has_value() || accessor.sparse.has_value()
+			|| accessor.bufferView.value() >= model.bufferViews.size())
+		{
+			continue;
+		}
+		const BufferView &bufferView = model.bufferViews[accessor.bufferView.value()];
+		const size_t size = componentSize(accessor.componentType);
+		const size_t offset = static_cast<size_t>(bufferView.byteOffset) + accessor.byteOffset;
+		if (bufferView.byteStride.has_value() || bufferView.buffer < 0
+			|| static_cast<size_t>(bufferView.buffer) >= buffers.size()
+			|| offset + static_cast<size_t>(accessor.count) * size > buffers[bufferView.buffer].size())
+		{
+			continue;
+		}
+
+		IndexData data{a, std::vector<uint32_t>(accessor.count), accessor.componentType};
+		if (!accessors.readIndices(accessor, std::span<uint32_t>(data.indices)))
+		{
+			continue;
+		}
+		const uint32_t maxIndex = data.indices.empty() ? 0
+							  : *std::max_element(data.indices.begin(), data.indices.end());
+		const ComponentType type = indexComponentType(static_cast<size_t>(maxIndex) + 1);
+		if (componentSize(type) < size)
+		{
+			data.type = type;
+		}
+		narrowing.bytesBefore += data.indices.size() * size;
+		views[accessor.bufferView.value()].push_back(std::move(data));
+	}
+
+	const std::vector<unsigned int> viewUses = countViewUses(model);
+	std::vector<std::byte> encoded;
+	for (size_t v = 0; v < views.size(); ++v)
+	{
+		std::vector<IndexData> &indexData = views[v];
+		if (indexData.empty())
+		{
+			continue;
+		}
+		BufferView &bufferView = model.bufferViews[v];
+		std::byte *viewData = buffers[bufferView.buffer].data() + bufferView.byteOffset;
+		std::sort(indexData.begin(), indexData.end(), [&](const IndexData &x, const IndexData &y) {
+			return model.accessors[x.accessor].byteOffset < model.accessors[y.accessor].byteOffset;
+		});
+
+		// Narrowing in place would clobber an overlapping accessor's old data
+		// before it's rewritten, so views whose accessors overlap stay as they
+		// are.
+		bool overlapping = false;
+		for (size_t i = 1; i < indexData.size(); ++i)
+		{
+			const Accessor &previous = model.accessors[indexData[i - 1].accessor];
+			overlapping = overlapping
+				|| previous.byteOffset + previous.count * componentSize(previous.componentType)
+					   > model.accessors[indexData[i].accessor].byteOffset;
+		}
+
+		// A view holding only these accessors is repacked from its start,
+		// each accessor aligned for its new type, and shortened to match.
+		// Otherwise each is narrowed where it starts, which frees nothing
+		// compactBuffers can release.
+		const bool repack = !overlapping && bufferView.byteLength.has_value() && viewUses[v] == indexData.size();
+		size_t cursor = 0;
+		for (const IndexData &data : indexData)
+		{
+			Accessor &accessor = model.accessors[data.accessor];
+			const size_t oldBytes = data.indices.size() * componentSize(accessor.componentType);
+			if (overlapping)
+			{
+				narrowing.bytesAfter += oldBytes;
+				continue;
+			}
+			const size_t size = componentSize(data.type);
+			if (repack)
+			{
+				// padding stays in the view, so it isn't released either
+				while ((bufferView.byteOffset + cursor) % size != 0)
+				{
+					++cursor;
+					++narrowing.bytesAfter;
+				}
+			}
+			else
+			{
+				cursor = accessor.byteOffset;
+			}
+
+			if (data.type != accessor.componentType)
+			{
+				++narrowing.narrowed;
+			}
+			encodeIndices(data.indices, data.type, encoded);
+			std::memcpy(viewData + cursor, encoded.data(), encoded.size());
+			accessor.componentType = data.type;
+			accessor.byteOffset = static_cast<byte_size>(cursor);
+			narrowing.bytesAfter += repack ? encoded.size() : oldBytes;
+			cursor += encoded.size();
+		}
+		if (repack)
+		{
+			bufferView.byteLength = static_cast<byte_size>(cursor);
+		}
+	}
+	return narrowing;
+}
+
+size_t Boiler::gltf::compactBuffers(Model &model, std::vector<std::vector<std::byte>> &buffers)
+{
+	size_t released = 0;
+	for (size_t b = 0; b < buffers.size() && b < model.buffers.size(); ++b)
+	{
+		std::vector<size_t> views;
+		bool known = true;
+		for (size_t v = 0; v < model.bufferViews.size(); ++v)
+		{
+			const BufferView &view = model.bufferViews[v];
+			if (view.buffer >= 0 && static_cast<size_t>(view.buffer) == b)
+			{
+				known = known && view.byteLength.has_value()
+					&& static_cast<size_t>(view.byteOffset) + view.byteLength.value() <= buffers[b].size();
+				views.push_back(v);
+			}
+		}
+		if (!known)
+		{
+			continue;
+		}
+		std::sort(views.begin(), views.end(), [&](size_t x, size_t y) {
+			return model.bufferViews[x].byteOffset < model.bufferViews[y].byteOffset;
+		});
+
+		// views are copied as runs of overlapping ranges, each run moved
+		// down to the next offset with its old remainder modulo 4
+		const std::vector<std::byte> &source = buffers[b];
+		std::vector<std::byte> packed;
+		packed.reserve(source.size());
+		size_t runBegin = 0, runEnd = 0, runTarget = 0;
+		const auto flush = [&]()
+		{
+			packed.insert(packed.end(), source.begin() + runBegin, source.begin() + runEnd);
+		};
+		for (size_t i = 0; i < views.size(); ++i)
+		{
+			BufferView &view = model.bufferViews[views[i]];
+			const size_t begin = view.byteOffset;
+			const size_t end = begin + view.byteLength.value();
+			if (i == 0 || begin >= runEnd)
+			{
+				if (i > 0)
+				{
+					flush();
+				}
+				runTarget = packed.size() + ((begin - packed.size()) & 3);
+				packed.resize(runTarget);
+				runBegin = begin;
+				runEnd = end;
+			}
+			runEnd = std::max(runEnd, end);
+			view.byteOffset = static_cast<byte_size>(runTarget + (begin - runBegin));
+		}
+		if (!views.empty())
+		{
+			flush();
+		}
+
+		released += source.size() - packed.size();
+		buffers[b] = std::move(packed);
+		model.buffers[b].byteLength = static_cast<byte_size>(buffers[b].size());
+	}
+	return released;
+}
@@ -0,0 +1,44 @@
+#ifndef INDEXBUFFERS_H
+#define INDEXBUFFERS_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "gltf.h"
+
+namespace Boiler { namespace gltf
+{
+	// Writes indices as UNSIGNED_BYTE, UNSIGNED_SHORT or UNSIGNED_INT values,
+	// truncating any that don't fit.
+	void encodeIndices(std::span<const uint32_t> indices, ComponentType type, std::vector<std::byte> &out);
+
+	struct IndexNarrowing
+	{
+		// index accessors rewritten in a narrower type
+		size_t narrowed = 0;
+		// The index data of every primitive before, and what it still takes
+		// up once compactBuffers has run. Indices narrowed in a view that
+		// holds other data still count at their old size.
+		size_t bytesBefore = 0;
+		size_t bytesAfter = 0;
+	};
+
+	// Re-encodes every primitive's indices in the narrowest type their
+	// largest index allows. A bufferView holding nothing but index data has
+	// its accessors packed together from its start, with their byteOffsets
+	// rewritten, and is shortened to fit. Anywhere else indices are narrowed
+	// at the start of their old bytes. buffers[i] holds the bytes of
+	// model.buffers[i]. Sparse accessors, those without data, those out of
+	// their buffer's bounds or in a strided view, and views whose index
+	// accessors overlap are left alone. compactBuffers then releases the
+	// bytes that freed.
+	IndexNarrowing narrowIndices(Model &model, std::vector<std::vector<std::byte>> &buffers);
+
+	// Repacks each buffer to just the byte ranges its bufferViews cover,
+	// moving the views down and keeping each one's offset modulo 4 so the
+	// accessors in it stay aligned. Buffers with a view of unknown length
+	// are left as they are. Returns the number of bytes released.
+	size_t compactBuffers(Model &model, std::vector<std::vector<std::byte>> &buffers);
+}}
+
+#endif /* INDEXBUFFERS_H */
@@ -0,0 +1,106 @@
+#include <filesystem>
+#include "lazyaccessors.h"
+
+using namespace Boiler::gltf;
+
+LazyModelAccessors::LazyModelAccessors(const Model &model, const std::string &basePath,
+									   std::shared_ptr<RangeCache> cache, BufferSources resident)
+	: model(model), cache(std::move(cache)), buffers(model.buffers.size())
+{
+	for (size_t i = 0; i < model.buffers.size(); ++i)
+	{
+		const Buffer &buffer = model.buffers[i];
+		if (i < resident.size() && resident[i])
+		{
+			buffers[i].resident = std::move(resident[i]);
+			continue;
+		}
+		if (buffer.uri.empty() || parseDataUri(buffer.uri).has_value())
+		{
+			continue;
+		}
+
+		std::filesystem::path bufferPath(basePath);
+		bufferPath.append(buffer.uri);
+		std::shared_ptr<const BufferFile> file = BufferFile::open(bufferPath.string());
+		if (file && file->size() >= buffer.byteLength)
+		{
+			buffers[i].file = std::move(file);
+			buffers[i].fileId = RangeCache::newFileId();
+		}
+	}
+}
+
+BufferViewData LazyModelAccessors::getBufferView(unsigned int bufferViewIndex) const
+{
+	if (bufferViewIndex >= model.bufferViews.size())
+	{
+		return {};
+	}
+	const BufferView &bufferView = model.bufferViews[bufferViewIndex];
+	if (bufferView.buffer < 0 || static_cast<size_t>(bufferView.buffer) >= buffers.size())
+	{
+		return {};
+	}
+
+	const LazyBuffer &buffer = buffers[bufferView.buffer];
+	const uint64_t bufferLength = model.buffers[bufferView.buffer].byteLength;
+	const uint64_t offset = bufferView.byteOffset;
+	const uint64_t length = bufferView.byteLength.value_or(offset < bufferLength ? bufferLength - offset : 0);
+	if (offset > bufferLength || length > bufferLength - offset)
+	{
+		return {};
+	}
+
+	if (buffer.resident)
+	{
+		const ByteSpan bytes = buffer.resident->data();
+		if (offset > bytes.size() || length > bytes.size() - offset)
+		{
+			return {};
+		}
+		return BufferViewData{buffer.resident, bytes.subspan(offset, length)};
+	}
+	if (!buffer.file)
+	{
+		return {};
+	}
+
+	RangeCache::Range range = cache->get(RangeCache::Key{buffer.fileId, offset, length},
+										 [&file = *buffer.file, offset](std::span<std::byte> out) {
+											 return file.read(offset, out);
+										 });
+	if (!range)
+	{
+		return {};
+	}
+	const ByteSpan bytes(*range);
+	return BufferViewData{std::move(range), bytes};
+}
+
+std::optional<BufferView> LazyModelAccessors::rebase(const Accessor &accessor, size_t elementBytes,
+													 BufferViewData &data) const
+{
+	if (!accessor.bufferView.has_value() || accessor.bufferView.value() >= model.bufferViews.size())
+	{
+		return std::nullopt;
+	}
+
+	BufferView view = model.bufferViews[accessor.bufferView.value()];
+	const size_t stride = view.byteStride.value_or(elementBytes);
+	if (stride < elementBytes)
+	{
+		return std::nullopt;
+	}
+
+	data = getBufferView(accessor.bufferView.value());
+	const size_t extent = accessor.count ? (accessor.count - 1) * stride + elementBytes : 0;
+	if (!data.owner || accessor.byteOffset > data.bytes.size() || extent > data.bytes.size() - accessor.byteOffset)
+	{
+		return std::nullopt;
+	}
+
+	// TypedAccessor offsets into the bufferView's bytes rather than the buffer
+	view.byteOffset = 0;
+	return view;
+}
@@ -0,0 +1,124 @@
+#ifndef LAZYACCESSORS_H
+#define LAZYACCESSORS_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "buffersource.h"
+#include "gltf.h"
+#include "rangecache.h"
+#include "typedaccessor.h"
+
+namespace Boiler { namespace gltf
+{
+	// The bytes of one bufferView and whatever keeps them alive.
+	struct BufferViewData
+	{
+		std::shared_ptr<const void> owner;
+		ByteSpan bytes;
+	};
+
+	// A TypedAccessor that keeps its bufferView's bytes alive, so it stays
+	// valid after the cache evicts them.
+	template<typename ComponentType, unsigned short NumComponents>
+	class LazyTypedAccessor : private BufferViewData, public TypedAccessor<ComponentType, NumComponents>
+	{
+	public:
+		// view is the accessor's bufferView with its byteOffset relative to
+		// data.bytes rather than the buffer
+		LazyTypedAccessor(BufferViewData data, const Accessor &accessor, const BufferView &view)
+			: BufferViewData(std::move(data)),
+			  TypedAccessor<ComponentType, NumComponents>(accessor, view, BufferViewData::bytes)
+		{
+		}
+	};
+
+	// Accessors over buffers that are never loaded whole. The first time an
+	// accessor of a bufferView is requested, that bufferView's byte range is
+	// read from the buffer's file with a positioned read and kept in a
+	// RangeCache, which may be shared between models to bound their combined
+	// memory. Nothing is read up front.
+	class LazyModelAccessors
+	{
+		struct LazyBuffer
+		{
+			std::shared_ptr<const BufferFile> file;
+			uint64_t fileId = 0;
+			// set for buffers served from memory instead of a file
+			std::shared_ptr<const BufferSource> resident;
+		};
+
+		const Model &model;
+		std::shared_ptr<RangeCache> cache;
+		std::vector<LazyBuffer> buffers;
+
+		std::optional<BufferView> rebase(const Accessor &accessor, size_t elementBytes, BufferViewData &data) const;
+
+	public:
+		// Opens the files behind the model's buffers. Buffers that aren't
+		// files, data uris or a GLB's BIN chunk, are taken from resident,
+		// indexed like model.buffers, if given there.
+		LazyModelAccessors(const Model &model, const std::string &basePath, std::shared_ptr<RangeCache> cache,
+						   BufferSources resident = {});
+
+		// Reads the bufferView's bytes unless they're cached. Returns an empty
+		// span and owner if the bufferView is out of range, its buffer is
+		// unavailable or the read fails.
+		BufferViewData getBufferView(unsigned int bufferViewIndex) const;
+
+		// Returns nullopt if the accessor has no bufferView, its elements
+		// don't fit within it or are misaligned, or its bytes can't be read.
+		template<typename ComponentType, unsigned short NumComponents>
+		std::optional<LazyTypedAccessor<ComponentType, NumComponents>> getTypedAccessor(const Accessor &accessor) const
+		{
+			BufferViewData data;
+			const std::optional<BufferView> view = rebase(accessor, sizeof(ComponentType) * NumComponents, data);
+			if (!view.has_value()
+				|| reinterpret_cast<uintptr_t>(data.bytes.data() + accessor.byteOffset) % alignof(ComponentType) != 0)
+			{
+				return std::nullopt;
+			}
+			return LazyTypedAccessor<ComponentType, NumComponents>(std::move(data), accessor, view.value());
+		}
+
+		template<typename ComponentType, unsigned short NumComponents>
+		std::optional<LazyTypedAccessor<ComponentType, NumComponents>> getTypedAccessor(unsigned int accessorIndex) const
+		{
+			if (accessorIndex >= model.accessors.size())
+			{
+				return std::nullopt;
+			}
+			return getTypedAccessor<ComponentType, NumComponents>(model.accessors[accessorIndex]);
+		}
+
+		template<typename ComponentType, unsigned short NumComponents>
+		std::optional<LazyTypedAccessor<ComponentType, NumComponents>> getTypedAccessor(const Primitive &primitive,
+																						Attribute attribute) const
+		{
+			const std::optional<int> found = primitive.attributes.find(attribute);
+			if (!found.has_value())
+			{
+				return std::nullopt;
+			}
+			return getTypedAccessor<ComponentType, NumComponents>(static_cast<unsigned int>(*found));
+		}
+
+		template<typename ComponentType, unsigned short NumComponents>
+		std::optional<LazyTypedAccessor<ComponentType, NumComponents>> getTypedAccessor(const Primitive &primitive,
+																						std::string_view attribute) const
+		{
+			const std::optional<int> found = primitive.attributes.find(attribute);
+			if (!found.has_value())
+			{
+				return std::nullopt;
+			}
+			return getTypedAccessor<ComponentType, NumComponents>(static_cast<unsigned int>(*found));
+		}
+
+		const Model &getModel() const { return model; }
+		const RangeCache &getCache() const { return *cache; }
+	};
+}}
+
+#endif /* LAZYACCESSORS_H */
@@ -0,0 +1,87 @@
+#include "loadstats.h"
+
+using namespace Boiler::gltf;
+
+const char *Boiler::gltf::phaseName(LoadPhase phase)
+{
+	switch (phase)
+	{
+		case LoadPhase::PARSE: return "parse";
+		case LoadPhase::ASSET: return "asset";
+		case LoadPhase::SCENES: return "scenes";
+		case LoadPhase::NODES: return "nodes";
+		case LoadPhase::MESHES: return "meshes";
+		case LoadPhase::ACCESSORS: return "accessors";
+		case LoadPhase::BUFFERS: return "buffers";
+		case LoadPhase::BUFFER_VIEWS: return "bufferViews";
+		case LoadPhase::MATERIALS: return "materials";
+		case LoadPhase::IMAGES: return "images";
+		case LoadPhase::TEXTURES: return "textures";
+		case LoadPhase::ANIMATIONS: return "animations";
+		case LoadPhase::SKINS: return "skins";
+		case LoadPhase::PHASE_COUNT: break;
+	}
+	return "unknown";
+}
+
+void LoadStats::beginLoad()
+{
+	if (allocationCounter)
+	{
+		lastAllocations = allocationCounter();
+	}
+}
+
+void LoadStats::phaseEnded(LoadPhase phase, double seconds, size_t elements)
+{
+	Phase &total = phases[static_cast<size_t>(phase)];
+	total.seconds += seconds;
+	total.elements += elements;
+	++total.count;
+	if (allocationCounter)
+	{
+		const uint64_t allocations = allocationCounter();
+		total.allocations += allocations - lastAllocations;
+		lastAllocations = allocations;
+	}
+}
+
+void LoadStats::bufferLoaded(size_t bufferIndex, size_t bytes, double seconds)
+{
+	std::lock_guard<std::mutex> lock(bufferMutex);
+	bufferReads.push_back(BufferRead{bufferIndex, bytes, seconds});
+}
+
+double LoadStats::totalSeconds() const
+{
+	double seconds = 0;
+	for (const Phase &phase : phases)
+	{
+		seconds += phase.seconds;
+	}
+	return seconds;
+}
+
+std::vector<LoadStats::BufferRead> LoadStats::buffers() const
+{
+	std::lock_guard<std::mutex> lock(bufferMutex);
+	return bufferReads;
+}
+
+size_t LoadStats::bytesRead() const
+{
+	std::lock_guard<std::mutex> lock(bufferMutex);
+	size_t bytes = 0;
+	for (const BufferRead &read : bufferReads)
+	{
+		bytes += read.bytes;
+	}
+	return bytes;
+}
+
+void LoadStats::reset()
+{
+	phases = {};
+	std::lock_guard<std::mutex> lock(bufferMutex);
+	bufferReads.clear();
+}
@@ -0,0 +1,176 @@
+#ifndef LOADSTATS_H
+#define LOADSTATS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Boiler { namespace gltf
+{
+	// The sections of a load, in the order load() runs them. The streaming
+	// loader reads them interleaved and reports a single PARSE phase.
+	enum class LoadPhase
+	{
+		PARSE,
+		ASSET,
+		SCENES,
+		NODES,
+		MESHES,
+		ACCESSORS,
+		BUFFERS,
+		BUFFER_VIEWS,
+		MATERIALS,
+		IMAGES,
+		TEXTURES,
+		ANIMATIONS,
+		SKINS,
+		PHASE_COUNT
+	};
+
+	const char *phaseName(LoadPhase phase);
+
+	// Receives timings from the loaders, which take a LoadObserver pointer
+	// and skip all timing when it's null. Defining BOILER_GLTF_NO_LOAD_STATS
+	// compiles the calls out altogether.
+	class LoadObserver
+	{
+	public:
+		virtual ~LoadObserver() = default;
+
+		// a load is starting, on this thread
+		virtual void beginLoad() {}
+		// the phase just ended after seconds, having read elements items, or
+		// for PARSE, bytes of JSON
+		virtual void phaseEnded(LoadPhase phase, double seconds, size_t elements) = 0;
+		// buffer bufferIndex was read, maybe on a worker thread
+		virtual void bufferLoaded(size_t /*bufferIndex*/, size_t /*bytes*/, double /*seconds*/) {}
+	};
+
+	// Times consecutive phases for an observer. With a null observer each
+	// call is a single branch.
+	class PhaseTimer
+	{
+#ifndef BOILER_GLTF_NO_LOAD_STATS
+		LoadObserver *observer;
+		std::chrono::steady_clock::time_point last;
+#endif
+
+	public:
+		explicit PhaseTimer([[maybe_unused]] LoadObserver *observer)
+#ifndef BOILER_GLTF_NO_LOAD_STATS
+			: observer(observer)
+		{
+			if (observer)
+			{
+				observer->beginLoad();
+				last = std::chrono::steady_clock::now();
+			}
+		}
+#else
+		{
+		}
+#endif
+
+		// ends phase, which started when the previous one ended
+		void end([[maybe_unused]] LoadPhase phase, [[maybe_unused]] size_t elements)
+		{
+#ifndef BOILER_GLTF_NO_LOAD_STATS
+			if (observer)
+			{
+				const auto now = std::chrono::steady_clock::now();
+				observer->phaseEnded(phase, std::chrono::duration<double>(now - last).count(), elements);
+				last = now;
+			}
+#endif
+		}
+	};
+
+	// Times one buffer read for an observer, on whichever thread reads it.
+	// With a null observer nothing is timed.
+	class BufferTimer
+	{
+#ifndef BOILER_GLTF_NO_LOAD_STATS
+		LoadObserver *observer;
+		std::chrono::steady_clock::time_point start;
+#endif
+
+	public:
+		explicit BufferTimer([[maybe_unused]] LoadObserver *observer)
+#ifndef BOILER_GLTF_NO_LOAD_STATS
+			: observer(observer)
+		{
+			if (observer)
+			{
+				start = std::chrono::steady_clock::now();
+			}
+		}
+#else
+		{
+		}
+#endif
+
+		// reports buffer bufferIndex as read, bytes long
+		void end([[maybe_unused]] size_t bufferIndex, [[maybe_unused]] size_t bytes)
+		{
+#ifndef BOILER_GLTF_NO_LOAD_STATS
+			if (observer)
+			{
+				const auto now = std::chrono::steady_clock::now();
+				observer->bufferLoaded(bufferIndex, bytes, std::chrono::duration<double>(now - start).count());
+			}
+#endif
+		}
+	};
+
+	// Accumulates the phases of every load observed, and every buffer read.
+	// Allocations are counted by sampling allocationCounter, e.g. a hook on
+	// the application's allocator, at each phase boundary. Phases assume one
+	// load at a time; buffer reads may be reported from any thread.
+	class LoadStats : public LoadObserver
+	{
+	public:
+		struct Phase
+		{
+			double seconds = 0;
+			size_t elements = 0;
+			uint64_t allocations = 0;
+			// how many loads reported the phase
+			unsigned int count = 0;
+		};
+
+		struct BufferRead
+		{
+			size_t bufferIndex;
+			size_t bytes;
+			double seconds;
+		};
+
+	private:
+		std::function<uint64_t()> allocationCounter;
+		uint64_t lastAllocations = 0;
+		std::array<Phase, static_cast<size_t>(LoadPhase::PHASE_COUNT)> phases;
+		mutable std::mutex bufferMutex;
+		std::vector<BufferRead> bufferReads;
+
+	public:
+		explicit LoadStats(std::function<uint64_t()> allocationCounter = {})
+			: allocationCounter(std::move(allocationCounter))
+		{
+		}
+
+		void beginLoad() override;
+		void phaseEnded(LoadPhase phase, double seconds, size_t elements) override;
+		void bufferLoaded(size_t bufferIndex, size_t bytes, double seconds) override;
+
+		const Phase &phase(LoadPhase phase) const { return phases[static_cast<size_t>(phase)]; }
+		double totalSeconds() const;
+		std::vector<BufferRead> buffers() const;
+		size_t bytesRead() const;
+		void reset();
+	};
+}}
+
+#endif /* LOADSTATS_H */
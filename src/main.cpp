@@ -4,6 +4,8 @@
 #include "gltf.h"
 #include "modelaccessors.h"
 
+using namespace Boiler;
+
 int main()
 {
 	// read the 
@@ -11,15 +13,21 @@ int main()
 	std::stringstream buffer;
 	buffer << t.rdbuf();
 
-	auto model = gltf::load(buffer.str());
+	auto model = gltf::load("models/Box.gltf", buffer.str());
 
-	std::vector<std::vector<std::byte>> buffers;
-	for (const auto &buffer : model.buffers)
+	// read all buffers concurrently, reporting any that failed
+	gltf::ThreadPool threadPool;
+	const auto bufferLoads = gltf::loadBuffers(model, "models/", threadPool);
+	for (size_t i = 0; i < bufferLoads.size(); ++i)
 	{
-		buffers.push_back(loadBuffer("models/", buffer));
+		if (!bufferLoads[i].get().ok())
+		{
+			std::cerr << "failed to load buffer " << i << std::endl;
+			return 1;
+		}
 	}
 
-	gltf::ModelAccessors modelAccess(model, std::move(buffers));
+	gltf::ModelAccessors modelAccess(model, gltf::waitForBuffers(bufferLoads));
 	for (auto &mesh : model.meshes)
 	{
 		for (auto &primitive : mesh.primitives)
@@ -27,7 +35,7 @@ int main()
 			using namespace gltf::attributes;
 
 			// get the primitive's position data
-			auto positionAccess = modelAccess.getTypedAccessor<float>(primitive, POSITION);
+			auto positionAccess = modelAccess.getTypedAccessor<float, 3>(primitive, POSITION);
 			for (auto values : positionAccess)
 			{
 				std::cout << values[0] << ", " << values[1] << ", " << values[2] << std::endl;
@@ -36,10 +44,12 @@ int main()
 			// check if we have indices for this primitive
 			if (primitive.indices.has_value())
 			{
-				auto indexAccess = modelAccess.getTypedAccessor<unsigned short>(primitive, primitive.indices.value());
-				for (auto index : indexAccess)
+				// indices may be bytes, shorts or ints; read them all as ints
+				std::vector<uint32_t> indices(model.accessors[primitive.indices.value()].count);
+				modelAccess.readIndices(primitive.indices.value(), std::span<uint32_t>(indices));
+				for (auto index : indices)
 				{
-					std::cout << index[0] << std::endl;
+					std::cout << index << std::endl;
 				}
 			}
 		}
@@ -4,6 +4,21 @@
 using namespace Boiler::gltf;
 
 ModelAccessors::ModelAccessors(const Model &model, const std::vector<std::vector<std::byte>> &buffers)
-	: model(model), buffers(buffers)
+	: model(model), buffers(buffers.begin(), buffers.end())
 {
 }
+
+ModelAccessors::ModelAccessors(const Model &model, std::vector<ByteSpan> buffers)
+	: model(model), buffers(std::move(buffers))
+{
+}
+
+ModelAccessors::ModelAccessors(const Model &model, BufferSources sources)
+	: model(model), sources(std::move(sources))
+{
+	buffers.reserve(this->sources.size());
+	for (const auto &source : this->sources)
+	{
+		buffers.push_back(source ? source->data() : ByteSpan());
+	}
+}
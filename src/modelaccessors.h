@@ -1,7 +1,11 @@
 #ifndef MODELACCESSORS_H
 #define MODELACCESSORS_H
 
+#include <algorithm>
 #include "gltf.h"
+#include "buffersource.h"
+#include "convert.h"
+#include "sparseaccessor.h"
 #include "typedaccessor.h"
 
 namespace Boiler { namespace gltf
@@ -11,19 +15,140 @@ namespace Boiler { namespace gltf
 	class ModelAccessors
 	{
 		const Model &model;
-		const std::vector<std::vector<std::byte>> &buffers;
+		std::vector<ByteSpan> buffers;
+		BufferSources sources;
+
+		static size_t loadIndex(ComponentType componentType, const std::byte *indices, size_t i)
+		{
+			switch (componentType)
+			{
+				case ComponentType::UNSIGNED_BYTE: return convert::load<uint8_t>(indices + i);
+				case ComponentType::UNSIGNED_SHORT: return convert::load<uint16_t>(indices + i * 2);
+				default: return convert::load<uint32_t>(indices + i * 4);
+			}
+		}
+
+		template<typename T>
+		static void convertComponents(const convert::Components &src, T *out, size_t outStride)
+		{
+			// single elements, as scattered for sparse accessors, skip the vector dispatch
+			if (src.count == 1)
+			{
+				convert::convertScalar(src, out, outStride);
+			}
+			else
+			{
+				convert::convert(src, out, outStride);
+			}
+		}
+
+		// converts count elements of the accessor's layout into packed values at out
+		template<typename T>
+		static void convertElements(const Accessor &accessor, const std::byte *data, size_t count, size_t stride, T *out)
+		{
+			const unsigned int components = componentCount(accessor.type);
+			const unsigned int columns = columnCount(accessor.type);
+			const unsigned int rows = components / columns;
+			const unsigned int columnBytes = columnSize(accessor.componentType, accessor.type);
+			if (columns > 1 && columnBytes != rows * componentSize(accessor.componentType))
+			{
+				// padded matrix columns are converted one column at a time
+				for (unsigned int column = 0; column < columns; ++column)
+				{
+					const convert::Components src{data + column * columnBytes, count, stride, rows,
+												  accessor.componentType, accessor.normalized};
+					convertComponents(src, out + column * rows, components);
+				}
+			}
+			else
+			{
+				const convert::Components src{data, count, stride, components,
+											  accessor.componentType, accessor.normalized};
+				convertComponents(src, out, components);
+			}
+		}
+
+		template<typename Component, typename Visitor>
+		bool visitComponents(const Accessor &accessor, Visitor &visitor) const
+		{
+			switch (accessor.type)
+			{
+				case AccessorType::SCALAR: return visitLayout<Component, 1>(accessor, visitor);
+				case AccessorType::VEC2: return visitLayout<Component, 2>(accessor, visitor);
+				case AccessorType::VEC3: return visitLayout<Component, 3>(accessor, visitor);
+				case AccessorType::VEC4: return visitLayout<Component, 4>(accessor, visitor);
+				case AccessorType::MAT2: return visitLayout<Component, 4>(accessor, visitor);
+				case AccessorType::MAT3: return visitLayout<Component, 9>(accessor, visitor);
+				case AccessorType::MAT4: return visitLayout<Component, 16>(accessor, visitor);
+			}
+			return false;
+		}
+
+		// All the checks visitAccessor makes before handing out a view, so the
+		// visitor's loops need none.
+		template<typename Component, unsigned short NumComponents, typename Visitor>
+		bool visitLayout(const Accessor &accessor, Visitor &visitor) const
+		{
+			constexpr size_t packedStride = sizeof(Component) * NumComponents;
+			if (!accessor.bufferView.has_value() || accessor.sparse.has_value()
+				|| accessor.bufferView.value() >= model.bufferViews.size()
+				|| elementSize(accessor.componentType, accessor.type) != packedStride)
+			{
+				// no data, sparse values or padded matrix columns
+				return false;
+			}
+
+			const BufferView &bufferView = model.bufferViews[accessor.bufferView.value()];
+			const size_t stride = bufferView.byteStride.value_or(packedStride);
+			if (bufferView.buffer >= buffers.size() || stride < packedStride || stride % alignof(Component) != 0)
+			{
+				return false;
+			}
+
+			const ByteSpan buffer = buffers[bufferView.buffer];
+			const size_t offset = static_cast<size_t>(accessor.byteOffset) + bufferView.byteOffset;
+			const size_t extent = accessor.count ? (accessor.count - 1) * stride + packedStride : 0;
+			if (offset > buffer.size() || extent > buffer.size() - offset
+				|| reinterpret_cast<uintptr_t>(buffer.data() + offset) % alignof(Component) != 0)
+			{
+				return false;
+			}
+
+			if (stride == packedStride)
+			{
+				visitor(TypedAccessor<Component, NumComponents, true>(accessor, bufferView, buffer));
+			}
+			else
+			{
+				visitor(TypedAccessor<Component, NumComponents>(accessor, bufferView, buffer));
+			}
+			return true;
+		}
 
 	public:
 		ModelAccessors(const gltf::Model &model, const std::vector<std::vector<std::byte>> &buffers);
+		ModelAccessors(const gltf::Model &model, std::vector<ByteSpan> buffers);
+		// shares ownership of the sources, so they stay valid as long as any copy of this object
+		ModelAccessors(const gltf::Model &model, BufferSources sources);
 
-		const Accessor &getAccessor(const Primitive &primitive, const std::string &attribute) const {
-			return model.accessors.at(primitive.attributes.find(attribute)->second);
+		// throw std::out_of_range if the primitive doesn't have the attribute
+		const Accessor &getAccessor(const Primitive &primitive, Attribute attribute) const {
+			return model.accessors.at(primitive.attributes.at(attribute));
+		}
+		const Accessor &getAccessor(const Primitive &primitive, std::string_view attribute) const {
+			return model.accessors.at(primitive.attributes.at(attribute));
+		}
+
+		template<typename ComponentType, unsigned short NumComponents>
+		TypedAccessor<ComponentType, NumComponents> getTypedAccessor(const Primitive &primitive, Attribute attribute) const
+		{
+			return getTypedAccessor<ComponentType, NumComponents>(model.accessors.at(primitive.attributes.at(attribute)));
 		}
 
 		template<typename ComponentType, unsigned short NumComponents>
-		TypedAccessor<ComponentType, NumComponents> getTypedAccessor(const Primitive &primitive, const std::string &attribute) const
+		TypedAccessor<ComponentType, NumComponents> getTypedAccessor(const Primitive &primitive, std::string_view attribute) const
 		{
-			return getTypedAccessor<ComponentType, NumComponents>(model.accessors.at(primitive.attributes.find(attribute)->second));
+			return getTypedAccessor<ComponentType, NumComponents>(model.accessors.at(primitive.attributes.at(attribute)));
 		}
 
 		template<typename ComponentType, unsigned short NumComponents>
@@ -40,19 +165,180 @@ namespace Boiler { namespace gltf
 
 			if (bufferView.byteStride.has_value())
 			{
-				assert(bufferView.byteStride.value() == sizeof(ComponentType) * NumComponents);
+				assert(bufferView.byteStride.value() >= sizeof(ComponentType) * NumComponents);
+			}
+
+			return TypedAccessor<ComponentType, NumComponents>(accessor, bufferView, buffers[bufferView.buffer]);
+		}
+
+		// Calls visitor with the TypedAccessor<C, N> or, for tightly packed data,
+		// TypedAccessor<C, N, true> matching the accessor's componentType and
+		// type, so a generic visitor is compiled once per layout with constant
+		// component count and, where possible, constant stride. Returns false
+		// without calling visitor if the accessor can't be viewed in place:
+		// no bufferView, sparse, padded matrix columns, misaligned or out of
+		// the buffer's bounds. readAccessor handles all of those.
+		template<typename Visitor>
+		bool visitAccessor(const Accessor &accessor, Visitor &&visitor) const
+		{
+			switch (accessor.componentType)
+			{
+				case ComponentType::BYTE: return visitComponents<int8_t>(accessor, visitor);
+				case ComponentType::UNSIGNED_BYTE: return visitComponents<uint8_t>(accessor, visitor);
+				case ComponentType::SHORT: return visitComponents<int16_t>(accessor, visitor);
+				case ComponentType::UNSIGNED_SHORT: return visitComponents<uint16_t>(accessor, visitor);
+				case ComponentType::UNSIGNED_INT: return visitComponents<uint32_t>(accessor, visitor);
+				case ComponentType::FLOAT: return visitComponents<float>(accessor, visitor);
 			}
+			return false;
+		}
+
+		template<typename Visitor>
+		bool visitAccessor(unsigned int accessorIndex, Visitor &&visitor) const
+		{
+			return accessorIndex < model.accessors.size()
+				&& visitAccessor(model.accessors[accessorIndex], std::forward<Visitor>(visitor));
+		}
+
+		// Lazy overlay of the accessor's sparse values on its base data, which
+		// doesn't allocate. Also works for accessors that aren't sparse.
+		template<typename ComponentType, unsigned short NumComponents>
+		SparseAccessor<ComponentType, NumComponents> getSparseAccessor(const Accessor &accessor) const
+		{
+			const std::byte *base = nullptr;
+			std::ptrdiff_t stride = sizeof(ComponentType) * NumComponents;
+			if (accessor.bufferView.has_value())
+			{
+				base = getPointer(accessor);
+				stride = model.bufferViews[accessor.bufferView.value()].byteStride.value_or(stride);
+			}
+
+			const std::byte *indices = nullptr, *values = nullptr;
+			if (accessor.sparse.has_value())
+			{
+				const Sparse &sparse = accessor.sparse.value();
+				indices = getPointer(sparse.indices.bufferView, sparse.indices.byteOffset);
+				values = getPointer(sparse.values.bufferView, sparse.values.byteOffset);
+			}
+
+			return SparseAccessor<ComponentType, NumComponents>(accessor, base, stride, indices, values);
+		}
 
-			const std::vector<std::byte> &data = buffers[bufferView.buffer];
+		template<typename ComponentType, unsigned short NumComponents>
+		SparseAccessor<ComponentType, NumComponents> getSparseAccessor(unsigned int accessorIndex) const
+		{
+			return getSparseAccessor<ComponentType, NumComponents>(model.accessors.at(accessorIndex));
+		}
 
-			return TypedAccessor<ComponentType, NumComponents>(accessor, bufferView, data);
+		const std::byte *getPointer(unsigned int bufferViewIndex, size_t byteOffset) const
+		{
+			const BufferView &bufferView = model.bufferViews[bufferViewIndex];
+			return buffers[bufferView.buffer].data() + (byteOffset + bufferView.byteOffset);
 		}
 
 		const std::byte *getPointer(const Accessor &accessor) const
 		{
 			const BufferView &bufferView = model.bufferViews[accessor.bufferView.value()];
-			const std::vector<std::byte> &data = buffers[bufferView.buffer];
-			return data.data() + (accessor.byteOffset + bufferView.byteOffset);
+			return buffers[bufferView.buffer].data() + (accessor.byteOffset + bufferView.byteOffset);
+		}
+
+		// Converts every component of the accessor to T in one pass, whatever
+		// its componentType and stride, writing count * componentCount values
+		// tightly packed into out. Normalized integers become [0, 1] or [-1, 1]
+		// when T is floating point. Sparse accessors are materialized with one
+		// bulk conversion followed by a scatter of the sparse values. Returns
+		// false if out is too small.
+		template<typename T>
+		bool readAccessor(const Accessor &accessor, std::span<T> out) const
+		{
+			const unsigned int components = componentCount(accessor.type);
+			const size_t valueCount = static_cast<size_t>(accessor.count) * components;
+			if (out.size() < valueCount)
+			{
+				return false;
+			}
+
+			if (accessor.bufferView.has_value())
+			{
+				const BufferView &bufferView = model.bufferViews[accessor.bufferView.value()];
+				const size_t stride = bufferView.byteStride.value_or(elementSize(accessor.componentType, accessor.type));
+				convertElements(accessor, getPointer(accessor), accessor.count, stride, out.data());
+			}
+			else
+			{
+				// an accessor without a bufferView is all zeros
+				std::fill_n(out.data(), valueCount, T());
+			}
+
+			if (accessor.sparse.has_value())
+			{
+				const Sparse &sparse = accessor.sparse.value();
+				const std::byte *indices = getPointer(sparse.indices.bufferView, sparse.indices.byteOffset);
+				const std::byte *values = getPointer(sparse.values.bufferView, sparse.values.byteOffset);
+				const size_t valueSize = elementSize(accessor.componentType, accessor.type);
+
+				for (size_t i = 0; i < sparse.count; ++i)
+				{
+					const size_t index = loadIndex(sparse.indices.componentType, indices, i);
+					if (index < accessor.count)
+					{
+						convertElements(accessor, values + i * valueSize, 1, valueSize, out.data() + index * components);
+					}
+				}
+			}
+			return true;
+		}
+
+		template<typename T>
+		bool readAccessor(unsigned int accessorIndex, std::span<T> out) const
+		{
+			return readAccessor<T>(model.accessors.at(accessorIndex), out);
+		}
+
+		// Reads indices of any width into out as T, with the vector
+		// conversions. Narrower types are checked first: returns false if an
+		// index doesn't fit in T, if the accessor isn't a SCALAR of unsigned
+		// bytes, shorts or ints, or if out is too small.
+		template<typename T>
+		bool readIndices(const Accessor &accessor, std::span<T> out) const
+		{
+			static_assert(std::is_integral_v<T> && std::is_unsigned_v<T>, "indices are unsigned");
+			if (accessor.type != AccessorType::SCALAR
+				|| (accessor.componentType != ComponentType::UNSIGNED_BYTE
+					&& accessor.componentType != ComponentType::UNSIGNED_SHORT
+					&& accessor.componentType != ComponentType::UNSIGNED_INT))
+			{
+				return false;
+			}
+			if (componentSize(accessor.componentType) <= sizeof(T))
+			{
+				return readAccessor(accessor, out);
+			}
+
+			std::vector<uint32_t> wide(accessor.count);
+			if (out.size() < wide.size() || !readAccessor(accessor, std::span<uint32_t>(wide)))
+			{
+				return false;
+			}
+			uint32_t maxIndex = 0;
+			for (uint32_t index : wide)
+			{
+				maxIndex = std::max(maxIndex, index);
+			}
+			if (maxIndex > std::numeric_limits<T>::max())
+			{
+				return false;
+			}
+			const convert::Components src{reinterpret_cast<const std::byte *>(wide.data()), wide.size(),
+										  sizeof(uint32_t), 1, ComponentType::UNSIGNED_INT, false};
+			convert::convert(src, out.data(), 1);
+			return true;
+		}
+
+		template<typename T>
+		bool readIndices(unsigned int accessorIndex, std::span<T> out) const
+		{
+			return readIndices<T>(model.accessors.at(accessorIndex), out);
 		}
 
 		const Model &getModel() const { return model; }
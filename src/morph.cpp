@@ -0,0 +1,248 @@
+#include <algorithm>
+#include "modelaccessors.h"
+#include "morph.h"
+#include "simd.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	// vertices blended per block, small enough that the block's inputs and
+	// outputs for all three attributes stay in cache
+	constexpr size_t blockVertices = 512;
+
+	constexpr Attribute semantics[MorphedPrimitive::ATTRIBUTE_COUNT] = {
+		Attribute::POSITION, Attribute::NORMAL, Attribute::TANGENT
+	};
+
+	// out[i] = base[i] + sum over t of weights[t] * deltas[t][i], for i in
+	// [begin, end)
+	void accumulateScalar(const float *base, const float *const *deltas, const float *weights, size_t targetCount,
+						  float *out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			float sum = base[i];
+			for (size_t t = 0; t < targetCount; ++t)
+			{
+				sum += weights[t] * deltas[t][i];
+			}
+			out[i] = sum;
+		}
+	}
+
+#ifdef BOILER_GLTF_X86
+	// each output is loaded and stored once however many targets there are
+	BOILER_TARGET_AVX2_FMA size_t accumulateAVX2(const float *base, const float *const *deltas, const float *weights,
+												 size_t targetCount, float *out, size_t begin, size_t end)
+	{
+		size_t i = begin;
+		for (; i + 16 <= end; i += 16)
+		{
+			__m256 low = _mm256_loadu_ps(base + i);
+			__m256 high = _mm256_loadu_ps(base + i + 8);
+			for (size_t t = 0; t < targetCount; ++t)
+			{
+				const __m256 weight = _mm256_set1_ps(weights[t]);
+				low = _mm256_fmadd_ps(weight, _mm256_loadu_ps(deltas[t] + i), low);
+				high = _mm256_fmadd_ps(weight, _mm256_loadu_ps(deltas[t] + i + 8), high);
+			}
+			_mm256_storeu_ps(out + i, low);
+			_mm256_storeu_ps(out + i + 8, high);
+		}
+		return i;
+	}
+#endif
+
+	void accumulate(const float *base, const float *const *deltas, const float *weights, size_t targetCount,
+					float *out, size_t begin, size_t end)
+	{
+#ifdef BOILER_GLTF_X86
+		if (simd::hasAVX2() && simd::hasFMA())
+		{
+			begin = accumulateAVX2(base, deltas, weights, targetCount, out, begin, end);
+		}
+#endif
+		accumulateScalar(base, deltas, weights, targetCount, out, begin, end);
+	}
+}
+
+std::optional<MorphedPrimitive> MorphedPrimitive::resolve(const ModelAccessors &accessors, const Primitive &primitive,
+														  float sparseFraction)
+{
+	const Model &model = accessors.getModel();
+	auto findAccessor = [&](const Attributes &attributes, Attribute semantic) -> const Accessor *
+	{
+		const std::optional<int> found = attributes.find(semantic);
+		if (!found.has_value() || static_cast<size_t>(*found) >= model.accessors.size())
+		{
+			return nullptr;
+		}
+		return &model.accessors[*found];
+	};
+
+	MorphedPrimitive morphed;
+	const Accessor *position = findAccessor(primitive.attributes, Attribute::POSITION);
+	if (!position)
+	{
+		return std::nullopt;
+	}
+	morphed.vertexCount = position->count;
+	const size_t floatCount = morphed.vertexCount * 3;
+
+	for (int attribute = 0; attribute < ATTRIBUTE_COUNT; ++attribute)
+	{
+		const Accessor *accessor = findAccessor(primitive.attributes, semantics[attribute]);
+		if (!accessor || accessor->count != morphed.vertexCount)
+		{
+			continue;
+		}
+
+		// tangents are VEC4; only x, y, z morph
+		const unsigned int components = componentCount(accessor->type);
+		if (components < 3)
+		{
+			continue;
+		}
+		std::vector<float> values(morphed.vertexCount * components);
+		accessors.readAccessor(*accessor, std::span<float>(values));
+		std::vector<float> &base = morphed.base[attribute];
+		base.resize(floatCount);
+		for (size_t v = 0; v < morphed.vertexCount; ++v)
+		{
+			std::copy_n(values.data() + v * components, 3, base.data() + v * 3);
+		}
+	}
+
+	for (const auto &targetAttributes : primitive.targets)
+	{
+		Target &target = morphed.targets.emplace_back();
+		for (int attribute = 0; attribute < ATTRIBUTE_COUNT; ++attribute)
+		{
+			const Accessor *accessor = findAccessor(targetAttributes, semantics[attribute]);
+			if (!accessor || morphed.base[attribute].empty())
+			{
+				continue;
+			}
+			if (accessor->count != morphed.vertexCount || componentCount(accessor->type) != 3)
+			{
+				return std::nullopt;
+			}
+			target.deltas[attribute].resize(floatCount);
+			accessors.readAccessor(*accessor, std::span<float>(target.deltas[attribute]));
+		}
+
+		// vertices any of the target's attributes move
+		std::vector<uint32_t> moved;
+		for (size_t v = 0; v < morphed.vertexCount; ++v)
+		{
+			for (const auto &deltas : target.deltas)
+			{
+				if (!deltas.empty() && (deltas[v * 3] != 0 || deltas[v * 3 + 1] != 0 || deltas[v * 3 + 2] != 0))
+				{
+					moved.push_back(static_cast<uint32_t>(v));
+					break;
+				}
+			}
+		}
+
+		if (moved.size() <= sparseFraction * morphed.vertexCount)
+		{
+			for (auto &deltas : target.deltas)
+			{
+				if (deltas.empty())
+				{
+					continue;
+				}
+				std::vector<float> compact(moved.size() * 3);
+				for (size_t i = 0; i < moved.size(); ++i)
+				{
+					std::copy_n(deltas.data() + moved[i] * 3, 3, compact.data() + i * 3);
+				}
+				deltas = std::move(compact);
+			}
+			target.indices = std::move(moved);
+			target.sparse = true;
+		}
+	}
+	return morphed;
+}
+
+bool MorphedPrimitive::blend(std::span<const float> weights, std::span<float> positions,
+							 std::span<float> normals, std::span<float> tangents) const
+{
+	const size_t floatCount = vertexCount * 3;
+	float *outputs[ATTRIBUTE_COUNT] = {positions.data(), normals.data(), tangents.data()};
+	const size_t outputSizes[ATTRIBUTE_COUNT] = {positions.size(), normals.size(), tangents.size()};
+	for (int attribute = 0; attribute < ATTRIBUTE_COUNT; ++attribute)
+	{
+		if (outputSizes[attribute] == 0 && attribute != POSITION)
+		{
+			outputs[attribute] = nullptr;
+		}
+		else if (base[attribute].empty() || outputSizes[attribute] < floatCount)
+		{
+			return false;
+		}
+	}
+
+	// the dense targets with a non-zero weight that move each attribute
+	std::vector<const float *> deltas[ATTRIBUTE_COUNT];
+	std::vector<float> activeWeights[ATTRIBUTE_COUNT];
+	const size_t weighted = std::min(weights.size(), targets.size());
+	for (size_t t = 0; t < weighted; ++t)
+	{
+		if (weights[t] == 0 || targets[t].sparse)
+		{
+			continue;
+		}
+		for (int attribute = 0; attribute < ATTRIBUTE_COUNT; ++attribute)
+		{
+			if (outputs[attribute] && !targets[t].deltas[attribute].empty())
+			{
+				deltas[attribute].push_back(targets[t].deltas[attribute].data());
+				activeWeights[attribute].push_back(weights[t]);
+			}
+		}
+	}
+
+	// one pass over the vertices, a block of every attribute at a time
+	for (size_t begin = 0; begin < floatCount; begin += blockVertices * 3)
+	{
+		const size_t end = std::min(floatCount, begin + blockVertices * 3);
+		for (int attribute = 0; attribute < ATTRIBUTE_COUNT; ++attribute)
+		{
+			if (outputs[attribute])
+			{
+				accumulate(base[attribute].data(), deltas[attribute].data(), activeWeights[attribute].data(),
+						   deltas[attribute].size(), outputs[attribute], begin, end);
+			}
+		}
+	}
+
+	for (size_t t = 0; t < weighted; ++t)
+	{
+		const Target &target = targets[t];
+		if (weights[t] == 0 || !target.sparse)
+		{
+			continue;
+		}
+		for (int attribute = 0; attribute < ATTRIBUTE_COUNT; ++attribute)
+		{
+			if (!outputs[attribute] || target.deltas[attribute].empty())
+			{
+				continue;
+			}
+			const float *delta = target.deltas[attribute].data();
+			float *out = outputs[attribute];
+			for (size_t i = 0; i < target.indices.size(); ++i)
+			{
+				float *vertex = out + target.indices[i] * 3;
+				vertex[0] += weights[t] * delta[i * 3];
+				vertex[1] += weights[t] * delta[i * 3 + 1];
+				vertex[2] += weights[t] * delta[i * 3 + 2];
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,66 @@
+#ifndef MORPH_H
+#define MORPH_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "gltf.h"
+
+namespace Boiler { namespace gltf
+{
+	class ModelAccessors;
+
+	// A primitive's base POSITION, NORMAL and TANGENT with every morph
+	// target's deltas, read once as packed x, y, z floats.
+	class MorphedPrimitive
+	{
+	public:
+		enum MorphAttribute
+		{
+			POSITION,
+			NORMAL,
+			TANGENT,
+			ATTRIBUTE_COUNT
+		};
+
+	private:
+		struct Target
+		{
+			// dense: count * 3 floats; sparse: one x, y, z per entry of indices.
+			// Empty for attributes the target doesn't move.
+			std::vector<float> deltas[ATTRIBUTE_COUNT];
+			std::vector<uint32_t> indices;
+			bool sparse = false;
+		};
+
+		size_t vertexCount = 0;
+		std::vector<float> base[ATTRIBUTE_COUNT];
+		std::vector<Target> targets;
+
+	public:
+		// Reads the base attributes and the deltas of every target. Targets
+		// that move at most sparseFraction of the vertices keep only those
+		// vertices' deltas and are applied by scattering them; 0 keeps every
+		// target dense. Returns nullopt without POSITION or if a target's
+		// accessors don't match the base vertex count.
+		static std::optional<MorphedPrimitive> resolve(const ModelAccessors &accessors, const Primitive &primitive,
+													   float sparseFraction = 0.25f);
+
+		size_t size() const { return vertexCount; }
+		size_t targetCount() const { return targets.size(); }
+		bool hasAttribute(MorphAttribute attribute) const { return !base[attribute].empty(); }
+		bool isSparse(size_t target) const { return targets[target].sparse; }
+
+		// Writes base + sum(weights[t] * deltas[t]) as packed x, y, z for each
+		// attribute whose output isn't empty, in one pass over the vertices
+		// that accumulates every dense target with a non-zero weight, then
+		// scatters the sparse ones. Missing weights count as zero. Tangent
+		// handedness isn't morphed and stays in the base TANGENT accessor.
+		// Returns false if an output is too small or its attribute is absent.
+		bool blend(std::span<const float> weights, std::span<float> positions,
+				   std::span<float> normals = {}, std::span<float> tangents = {}) const;
+	};
+}}
+
+#endif /* MORPH_H */
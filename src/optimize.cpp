@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include "modelaccessors.h"
+#include "optimize.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	constexpr uint32_t none = ~0u;
+	constexpr int TRIANGLES = 4;
+
+	// A FIFO cache simulated with one timestamp per vertex: a vertex is cached
+	// if it missed within the last cacheSize misses. Advancing the clock by
+	// more than the cache size empties it.
+	class FifoCache
+	{
+		std::vector<uint32_t> timestamps;
+		uint32_t time;
+		unsigned int cacheSize;
+
+	public:
+		FifoCache(size_t vertexCount, unsigned int cacheSize)
+			: timestamps(vertexCount, 0), time(cacheSize + 1), cacheSize(cacheSize) {}
+
+		// returns true on a miss
+		bool access(uint32_t vertex)
+		{
+			if (time - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = time++;
+				return true;
+			}
+			return false;
+		}
+
+		unsigned int triangleMisses(const uint32_t *triangle)
+		{
+			return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+		}
+
+		bool seen(uint32_t vertex) const { return timestamps[vertex] != 0; }
+		uint32_t age(uint32_t vertex) const { return time - timestamps[vertex]; }
+		void flush() { time += cacheSize + 1; }
+	};
+
+	struct Vector3
+	{
+		float x, y, z;
+	};
+
+	Vector3 loadPosition(std::span<const float> positions, uint32_t vertex)
+	{
+		return {positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2]};
+	}
+
+	// integer destinations of readAccessor keep the bits, so this copies
+	// without converting
+	template<typename T>
+	bool readElements(const ModelAccessors &accessors, const Accessor &accessor, std::vector<std::byte> &out)
+	{
+		std::vector<T> values(static_cast<size_t>(accessor.count) * componentCount(accessor.type));
+		if (!accessors.readAccessor(accessor, std::span<T>(values)))
+		{
+			return false;
+		}
+		out.resize(values.size() * sizeof(T));
+		std::memcpy(out.data(), values.data(), out.size());
+		return true;
+	}
+
+	bool readElements(const ModelAccessors &accessors, const Accessor &accessor, std::vector<std::byte> &out)
+	{
+		switch (accessor.componentType)
+		{
+			case ComponentType::BYTE: return readElements<int8_t>(accessors, accessor, out);
+			case ComponentType::UNSIGNED_BYTE: return readElements<uint8_t>(accessors, accessor, out);
+			case ComponentType::SHORT: return readElements<int16_t>(accessors, accessor, out);
+			case ComponentType::UNSIGNED_SHORT: return readElements<uint16_t>(accessors, accessor, out);
+			case ComponentType::UNSIGNED_INT: return readElements<uint32_t>(accessors, accessor, out);
+			case ComponentType::FLOAT: return readElements<float>(accessors, accessor, out);
+		}
+		return false;
+	}
+
+	const Accessor *findAccessor(const Model &model, int index)
+	{
+		return index >= 0 && static_cast<size_t>(index) < model.accessors.size() ? &model.accessors[index] : nullptr;
+	}
+
+	// Reads every attribute in attributes and moves each element to its
+	// vertex's new position.
+	bool packAttributes(const ModelAccessors &accessors, const Attributes &attributes, size_t sourceCount,
+						const std::vector<uint32_t> &remap, size_t vertexCount, std::vector<PackedAttribute> &out)
+	{
+		for (const auto &[name, index] : attributes)
+		{
+			const Accessor *accessor = findAccessor(accessors.getModel(), index);
+			if (!accessor || accessor->count != sourceCount)
+			{
+				return false;
+			}
+			std::optional<PackedAttribute> packed = PackedAttribute::read(accessors, name, *accessor);
+			if (!packed.has_value())
+			{
+				return false;
+			}
+			packed->remap(remap, vertexCount);
+			out.push_back(std::move(packed.value()));
+		}
+		return true;
+	}
+}
+
+std::optional<PackedAttribute> PackedAttribute::read(const ModelAccessors &accessors, std::string_view name,
+													 const Accessor &accessor)
+{
+	if (columnCount(accessor.type) > 1)
+	{
+		return std::nullopt;
+	}
+	PackedAttribute packed{name, accessor.componentType, accessor.type, accessor.normalized, {}};
+	if (!readElements(accessors, accessor, packed.data))
+	{
+		return std::nullopt;
+	}
+	return packed;
+}
+
+void PackedAttribute::remap(std::span<const uint32_t> remap, size_t vertexCount)
+{
+	const size_t bytes = elementBytes();
+	const size_t sourceCount = std::min(size(), remap.size());
+	std::vector<std::byte> remapped(vertexCount * bytes);
+	// backwards, so the first of the elements mapped to one place wins
+	for (size_t vertex = sourceCount; vertex-- > 0;)
+	{
+		if (remap[vertex] != none)
+		{
+			std::memcpy(remapped.data() + remap[vertex] * bytes, data.data() + vertex * bytes, bytes);
+		}
+	}
+	data = std::move(remapped);
+}
+
+VertexCacheStats optimize::analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	stats.triangles = indices.size() / 3;
+	FifoCache cache(vertexCount, cacheSize);
+	for (size_t i = 0; i < stats.triangles * 3; ++i)
+	{
+		stats.vertices += !cache.seen(indices[i]);
+		stats.transformed += cache.access(indices[i]);
+	}
+	return stats;
+}
+
+std::vector<uint32_t> optimize::optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, unsigned int cacheSize)
+{
+	const size_t triangleCount = indices.size() / 3;
+	std::vector<uint32_t> clusters;
+	if (triangleCount == 0)
+	{
+		return clusters;
+	}
+
+	// the triangles using each vertex, adjacency[offsets[v]] to
+	// adjacency[offsets[v + 1]], and how many of them are still to be emitted
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		++live[indices[i]];
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	std::partial_sum(live.begin(), live.end(), offsets.begin() + 1);
+	std::vector<uint32_t> adjacency(offsets.back());
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	// recently emitted vertices to resume from, then a scan of all of them
+	std::vector<uint32_t> deadEnds;
+	size_t cursor = 0;
+	std::vector<uint32_t> candidates;
+
+	const auto skipDeadEnd = [&]() -> uint32_t
+	{
+		while (!deadEnds.empty())
+		{
+			const uint32_t vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[vertex] > 0)
+			{
+				return vertex;
+			}
+		}
+		for (; cursor < vertexCount; ++cursor)
+		{
+			if (live[cursor] > 0)
+			{
+				return static_cast<uint32_t>(cursor);
+			}
+		}
+		return none;
+	};
+
+	uint32_t fan = skipDeadEnd();
+	clusters.push_back(0);
+	while (fan != none)
+	{
+		candidates.clear();
+		for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; ++a)
+		{
+			const uint32_t triangle = adjacency[a];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = 1;
+			for (unsigned int corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--live[vertex];
+				cache.access(vertex);
+			}
+		}
+
+		// the oldest candidate that is still cached after fanning its
+		// remaining triangles, each of which can add two vertices
+		uint32_t next = none;
+		int64_t best = -1;
+		for (uint32_t vertex : candidates)
+		{
+			if (live[vertex] == 0)
+			{
+				continue;
+			}
+			const int64_t age = cache.age(vertex);
+			const int64_t priority = age + 2 * static_cast<int64_t>(live[vertex]) <= cacheSize ? age : 0;
+			if (priority > best)
+			{
+				best = priority;
+				next = vertex;
+			}
+		}
+
+		if (next == none)
+		{
+			next = skipDeadEnd();
+			if (next != none)
+			{
+				clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+			}
+		}
+		fan = next;
+	}
+
+	std::copy(output.begin(), output.end(), indices.begin());
+	return clusters;
+}
+
+void optimize::optimizeOverdraw(std::span<uint32_t> indices, std::span<const uint32_t> clusters,
+								std::span<const float> positions, unsigned int cacheSize, float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || clusters.empty())
+	{
+		return;
+	}
+
+	// split each cluster wherever it has caught up with its own ACMR, so
+	// every piece starting with a cold cache costs little
+	FifoCache cache(positions.size() / 3, cacheSize);
+	std::vector<uint32_t> pieces;
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		const size_t begin = clusters[c];
+		const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		cache.flush();
+		size_t misses = 0;
+		for (size_t t = begin; t < end; ++t)
+		{
+			misses += cache.triangleMisses(&indices[t * 3]);
+		}
+		const float target = threshold * misses / (end - begin);
+
+		cache.flush();
+		pieces.push_back(static_cast<uint32_t>(begin));
+		size_t pieceBegin = begin;
+		misses = 0;
+		for (size_t t = begin; t + 1 < end; ++t)
+		{
+			misses += cache.triangleMisses(&indices[t * 3]);
+			if (misses <= target * (t + 1 - pieceBegin))
+			{
+				pieceBegin = t + 1;
+				pieces.push_back(static_cast<uint32_t>(pieceBegin));
+				misses = 0;
+				cache.flush();
+			}
+		}
+	}
+
+	// area weighted centroids and normals of the pieces and the whole mesh
+	struct Piece
+	{
+		Vector3 centroid{0, 0, 0};
+		Vector3 normal{0, 0, 0};
+		float area = 0;
+	};
+	std::vector<Piece> summaries(pieces.size());
+	Vector3 meshCentroid{0, 0, 0};
+	float meshArea = 0;
+	for (size_t p = 0; p < pieces.size(); ++p)
+	{
+		const size_t end = p + 1 < pieces.size() ? pieces[p + 1] : triangleCount;
+		Piece &piece = summaries[p];
+		for (size_t t = pieces[p]; t < end; ++t)
+		{
+			const Vector3 a = loadPosition(positions, indices[t * 3]);
+			const Vector3 b = loadPosition(positions, indices[t * 3 + 1]);
+			const Vector3 c = loadPosition(positions, indices[t * 3 + 2]);
+			const Vector3 ab{b.x - a.x, b.y - a.y, b.z - a.z};
+			const Vector3 ac{c.x - a.x, c.y - a.y, c.z - a.z};
+			const Vector3 cross{ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x};
+			const float area = std::sqrt(cross.x * cross.x + cross.y * cross.y + cross.z * cross.z);
+
+			piece.centroid.x += (a.x + b.x + c.x) * area;
+			piece.centroid.y += (a.y + b.y + c.y) * area;
+			piece.centroid.z += (a.z + b.z + c.z) * area;
+			piece.normal.x += cross.x;
+			piece.normal.y += cross.y;
+			piece.normal.z += cross.z;
+			piece.area += area;
+		}
+		meshCentroid.x += piece.centroid.x;
+		meshCentroid.y += piece.centroid.y;
+		meshCentroid.z += piece.centroid.z;
+		meshArea += piece.area;
+	}
+	const float meshScale = meshArea > 0 ? 1.0f / (meshArea * 3) : 0.0f;
+	meshCentroid = {meshCentroid.x * meshScale, meshCentroid.y * meshScale, meshCentroid.z * meshScale};
+
+	// pieces facing away from the center first
+	std::vector<float> keys(pieces.size());
+	for (size_t p = 0; p < pieces.size(); ++p)
+	{
+		const Piece &piece = summaries[p];
+		const float scale = piece.area > 0 ? 1.0f / (piece.area * 3) : 0.0f;
+		const Vector3 offset{piece.centroid.x * scale - meshCentroid.x, piece.centroid.y * scale - meshCentroid.y,
+							 piece.centroid.z * scale - meshCentroid.z};
+		const float length = std::sqrt(piece.normal.x * piece.normal.x + piece.normal.y * piece.normal.y
+									   + piece.normal.z * piece.normal.z);
+		keys[p] = length > 0 ? (offset.x * piece.normal.x + offset.y * piece.normal.y + offset.z * piece.normal.z) / length
+							 : 0.0f;
+	}
+	std::vector<uint32_t> order(pieces.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(triangleCount * 3);
+	for (uint32_t p : order)
+	{
+		const size_t end = p + 1 < pieces.size() ? pieces[p + 1] : triangleCount;
+		sorted.insert(sorted.end(), indices.begin() + pieces[p] * 3, indices.begin() + end * 3);
+	}
+	std::copy(sorted.begin(), sorted.end(), indices.begin());
+}
+
+size_t optimize::optimizeVertexFetch(std::span<uint32_t> indices, size_t vertexCount, std::vector<uint32_t> &remap)
+{
+	remap.assign(vertexCount, none);
+	uint32_t next = 0;
+	for (uint32_t &index : indices)
+	{
+		if (remap[index] == none)
+		{
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+	return next;
+}
+
+std::optional<OptimizedPrimitive> OptimizedPrimitive::optimize(const ModelAccessors &accessors, const Primitive &primitive,
+															   const OptimizeOptions &options)
+{
+	const Model &model = accessors.getModel();
+	if (primitive.mode.value_or(TRIANGLES) != TRIANGLES)
+	{
+		return std::nullopt;
+	}
+	const std::optional<int> positionIndex = primitive.attributes.find(Attribute::POSITION);
+	const Accessor *position = findAccessor(model, positionIndex.value_or(-1));
+	if (!position || position->type != AccessorType::VEC3 || position->componentType != ComponentType::FLOAT)
+	{
+		return std::nullopt;
+	}
+	const size_t sourceCount = position->count;
+
+	std::vector<uint32_t> indices;
+	if (primitive.indices.has_value())
+	{
+		const Accessor *indexAccessor = findAccessor(model, primitive.indices.value());
+		if (!indexAccessor || indexAccessor->type != AccessorType::SCALAR)
+		{
+			return std::nullopt;
+		}
+		indices.resize(indexAccessor->count);
+		if (!accessors.readAccessor(*indexAccessor, std::span<uint32_t>(indices)))
+		{
+			return std::nullopt;
+		}
+	}
+	else
+	{
+		indices.resize(sourceCount);
+		std::iota(indices.begin(), indices.end(), 0);
+	}
+	// a trailing partial triangle isn't drawn
+	indices.resize(indices.size() / 3 * 3);
+	if (std::any_of(indices.begin(), indices.end(), [&](uint32_t index) { return index >= sourceCount; }))
+	{
+		return std::nullopt;
+	}
+
+	OptimizedPrimitive optimized;
+	optimized.before = optimize::analyzeVertexCache(indices, sourceCount, options.cacheSize);
+
+	const std::vector<uint32_t> clusters = optimize::optimizeVertexCache(indices, sourceCount, options.cacheSize);
+	if (options.reduceOverdraw)
+	{
+		std::vector<float> positions(sourceCount * 3);
+		if (!accessors.readAccessor(*position, std::span<float>(positions)))
+		{
+			return std::nullopt;
+		}
+		optimize::optimizeOverdraw(indices, clusters, positions, options.cacheSize, options.overdrawThreshold);
+	}
+	optimized.vertexCount = optimize::optimizeVertexFetch(indices, sourceCount, optimized.remap);
+	optimized.after = optimize::analyzeVertexCache(indices, optimized.vertexCount, options.cacheSize);
+	optimized.indices = std::move(indices);
+
+	if (!packAttributes(accessors, primitive.attributes, sourceCount, optimized.remap, optimized.vertexCount,
+						optimized.attributes))
+	{
+		return std::nullopt;
+	}
+	for (const Attributes &target : primitive.targets)
+	{
+		if (!packAttributes(accessors, target, sourceCount, optimized.remap, optimized.vertexCount,
+							optimized.targets.emplace_back()))
+		{
+			return std::nullopt;
+		}
+	}
+	return optimized;
+}
@@ -0,0 +1,116 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "gltf.h"
+
+namespace Boiler { namespace gltf
+{
+	class ModelAccessors;
+
+	// How well a triangle list uses a FIFO post-transform vertex cache.
+	struct VertexCacheStats
+	{
+		size_t triangles = 0;
+		// distinct vertices the triangles reference
+		size_t vertices = 0;
+		// cache misses, each of which runs the vertex shader
+		size_t transformed = 0;
+
+		// average cache miss ratio: transforms per triangle, 0.5 at best for
+		// large regular meshes, 3 at worst
+		float acmr() const { return triangles ? static_cast<float>(transformed) / triangles : 0.0f; }
+		// average transform to vertex ratio: 1 means every vertex is
+		// transformed exactly once
+		float atvr() const { return vertices ? static_cast<float>(transformed) / vertices : 0.0f; }
+	};
+
+	// Passes over 32-bit triangle list indices, each usable on its own.
+	namespace optimize
+	{
+		VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, unsigned int cacheSize);
+
+		// Reorders the triangles for a FIFO cache of cacheSize vertices with
+		// Tipsify (Sander, Nehab and Barczak 2007), which fans around the
+		// vertex that will stay cached longest. Returns the index of the first
+		// triangle of each run that starts at a dead end, where the cache
+		// holds nothing useful; these are the hard boundaries optimizeOverdraw
+		// may reorder at.
+		std::vector<uint32_t> optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, unsigned int cacheSize);
+
+		// Splits the runs starting at clusters further wherever the ACMR so
+		// far is within threshold of the run's, then sorts the pieces so the
+		// ones facing away from the mesh's center, which tend to occlude the
+		// rest, are drawn first. positions are packed x, y, z floats. A
+		// threshold of 1.05 gives up about 5% of the cache efficiency.
+		void optimizeOverdraw(std::span<uint32_t> indices, std::span<const uint32_t> clusters,
+							  std::span<const float> positions, unsigned int cacheSize, float threshold);
+
+		// Renumbers the vertices in the order the indices first use them, so
+		// vertex fetch walks each attribute forwards. Fills remap with each
+		// old vertex's new index, or ~0u if no triangle uses it, and returns
+		// the number of vertices used.
+		size_t optimizeVertexFetch(std::span<uint32_t> indices, size_t vertexCount, std::vector<uint32_t> &remap);
+	}
+
+	struct OptimizeOptions
+	{
+		// FIFO entries to optimize for; 16 suits most desktop and mobile GPUs
+		unsigned int cacheSize = 16;
+		bool reduceOverdraw = true;
+		// the ACMR overdraw reduction may trade away, as a factor
+		float overdrawThreshold = 1.05f;
+	};
+
+	// One attribute's elements in their original component type, tightly
+	// packed.
+	struct PackedAttribute
+	{
+		// a view of the name in the primitive's Attributes
+		std::string_view name;
+		ComponentType componentType;
+		AccessorType type;
+		bool normalized;
+		std::vector<std::byte> data;
+
+		// Copies the accessor's elements with any sparse values applied.
+		// Returns nullopt for matrices, which aren't vertex attributes.
+		static std::optional<PackedAttribute> read(const ModelAccessors &accessors, std::string_view name,
+												   const Accessor &accessor);
+
+		size_t elementBytes() const { return elementSize(componentType, type); }
+		size_t size() const { return data.size() / elementBytes(); }
+
+		// Moves element v to remap[v] of vertexCount, dropping those mapped
+		// to ~0u. Where several map to one, the first of them is kept.
+		void remap(std::span<const uint32_t> remap, size_t vertexCount);
+	};
+
+	// A triangle list primitive reordered for the vertex cache, overdraw and
+	// vertex fetch, with every attribute and morph target rewritten into new
+	// packed buffers in the new vertex order.
+	struct OptimizedPrimitive
+	{
+		std::vector<uint32_t> indices;
+		size_t vertexCount = 0;
+		std::vector<PackedAttribute> attributes;
+		// one per morph target, in the primitive's order
+		std::vector<std::vector<PackedAttribute>> targets;
+		// each original vertex's new index, ~0u for vertices no triangle uses
+		std::vector<uint32_t> remap;
+		VertexCacheStats before, after;
+
+		// Non-indexed primitives are optimized as if indexed 0, 1, 2...
+		// Returns nullopt for modes other than TRIANGLES, without a float VEC3
+		// POSITION, if attribute counts differ, for matrix attributes or if an
+		// index is out of range.
+		static std::optional<OptimizedPrimitive> optimize(const ModelAccessors &accessors, const Primitive &primitive,
+														  const OptimizeOptions &options = {});
+	};
+}}
+
+#endif /* OPTIMIZE_H */
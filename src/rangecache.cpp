@@ -0,0 +1,97 @@
+#include <atomic>
+#include "rangecache.h"
+
+using namespace Boiler::gltf;
+
+RangeCache::RangeCache(size_t byteBudget) : byteBudget(byteBudget)
+{
+}
+
+void RangeCache::evict()
+{
+	while (counters.residentBytes > byteBudget && !entries.empty())
+	{
+		const Entry &entry = entries.back();
+		counters.residentBytes -= entry.range->size();
+		counters.bytesEvicted += entry.range->size();
+		++counters.evictions;
+		index.erase(entry.key);
+		entries.pop_back();
+	}
+	counters.residentRanges = entries.size();
+}
+
+RangeCache::Range RangeCache::get(const Key &key, const ReadRange &read)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto found = index.find(key);
+		if (found != index.end())
+		{
+			++counters.hits;
+			entries.splice(entries.begin(), entries, found->second);
+			return found->second->range;
+		}
+		++counters.misses;
+	}
+
+	auto bytes = std::make_shared<std::vector<std::byte>>(key.size);
+	if (!read(*bytes))
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	counters.bytesRead += key.size;
+	const auto found = index.find(key);
+	if (found != index.end())
+	{
+		// another thread read it meanwhile, share its copy
+		entries.splice(entries.begin(), entries, found->second);
+		return found->second->range;
+	}
+	if (key.size > byteBudget)
+	{
+		return bytes;
+	}
+
+	entries.push_front(Entry{key, bytes});
+	index.emplace(key, entries.begin());
+	counters.residentBytes += key.size;
+	evict();
+	return bytes;
+}
+
+size_t RangeCache::budget() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return byteBudget;
+}
+
+void RangeCache::setBudget(size_t byteBudget)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->byteBudget = byteBudget;
+	evict();
+}
+
+void RangeCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	index.clear();
+	counters.residentBytes = 0;
+	counters.residentRanges = 0;
+}
+
+RangeCache::Stats RangeCache::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return counters;
+}
+
+uint64_t RangeCache::newFileId()
+{
+	static std::atomic<uint64_t> nextId{1};
+	return nextId.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,96 @@
+#ifndef RANGECACHE_H
+#define RANGECACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace Boiler { namespace gltf
+{
+	// Byte ranges read from files, kept in least recently used order within a
+	// byte budget. Ranges are handed out as shared pointers, so evicting one
+	// only drops the cache's reference and whoever is still using it keeps it
+	// alive. Thread safe; one cache can serve any number of models.
+	class RangeCache
+	{
+	public:
+		using Range = std::shared_ptr<const std::vector<std::byte>>;
+		// fills the range's bytes, returns false on failure
+		using ReadRange = std::function<bool(std::span<std::byte> out)>;
+
+		struct Key
+		{
+			// identifies the file, e.g. from newFileId()
+			uint64_t file;
+			uint64_t offset;
+			uint64_t size;
+
+			bool operator==(const Key &) const = default;
+		};
+
+		struct Stats
+		{
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t evictions = 0;
+			uint64_t bytesRead = 0;
+			uint64_t bytesEvicted = 0;
+			// bytes the cache holds, at most the budget once a get returns
+			size_t residentBytes = 0;
+			size_t residentRanges = 0;
+		};
+
+	private:
+		struct KeyHash
+		{
+			size_t operator()(const Key &key) const
+			{
+				uint64_t hash = key.file * 0x9e3779b97f4a7c15ull;
+				hash = (hash ^ key.offset) * 0x9e3779b97f4a7c15ull;
+				hash = (hash ^ key.size) * 0x9e3779b97f4a7c15ull;
+				return static_cast<size_t>(hash ^ (hash >> 32));
+			}
+		};
+
+		struct Entry
+		{
+			Key key;
+			Range range;
+		};
+
+		mutable std::mutex mutex;
+		size_t byteBudget;
+		// most recently used first
+		std::list<Entry> entries;
+		std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+		Stats counters;
+
+		void evict();
+
+	public:
+		explicit RangeCache(size_t byteBudget);
+
+		// Returns the cached range or reads it with read, caching it. Reads
+		// happen outside the lock, so concurrent misses on different ranges
+		// overlap. Returns nullptr if read fails. A range larger than the
+		// whole budget is returned but not kept.
+		Range get(const Key &key, const ReadRange &read);
+
+		size_t budget() const;
+		// shrinking the budget evicts straight away
+		void setBudget(size_t byteBudget);
+		// drops every cached range, ranges in use stay valid
+		void clear();
+		Stats stats() const;
+
+		// a process-wide unique id for Key::file
+		static uint64_t newFileId();
+	};
+}}
+
+#endif /* RANGECACHE_H */
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include "scenegraph.h"
+#include "simd.h"
+#include "threadpool.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	// levels smaller than this aren't worth splitting across threads
+	constexpr size_t parallelGrain = 4096;
+}
+
+Matrix4 Boiler::gltf::multiply(const Matrix4 &a, const Matrix4 &b)
+{
+	Matrix4 result;
+#if defined(BOILER_GLTF_X86) && (defined(__SSE__) || defined(_M_X64))
+	// each result column is a linear combination of a's columns
+	const __m128 a0 = _mm_loadu_ps(&a[0]);
+	const __m128 a1 = _mm_loadu_ps(&a[4]);
+	const __m128 a2 = _mm_loadu_ps(&a[8]);
+	const __m128 a3 = _mm_loadu_ps(&a[12]);
+	for (int column = 0; column < 4; ++column)
+	{
+		const float *factors = &b[column * 4];
+		__m128 sum = _mm_mul_ps(a0, _mm_set1_ps(factors[0]));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(factors[1])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(factors[2])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(factors[3])));
+		_mm_storeu_ps(&result[column * 4], sum);
+	}
+#else
+	for (int column = 0; column < 4; ++column)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			result[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1]
+				+ a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+		}
+	}
+#endif
+	return result;
+}
+
+Matrix4 Boiler::gltf::composeTRS(const floatArray3 &t, const floatArray4 &r, const floatArray3 &s)
+{
+	const float x = r[0], y = r[1], z = r[2], w = r[3];
+	return {
+		(1 - 2 * (y * y + z * z)) * s[0], 2 * (x * y + z * w) * s[0], 2 * (x * z - y * w) * s[0], 0,
+		2 * (x * y - z * w) * s[1], (1 - 2 * (x * x + z * z)) * s[1], 2 * (y * z + x * w) * s[1], 0,
+		2 * (x * z + y * w) * s[2], 2 * (y * z - x * w) * s[2], (1 - 2 * (x * x + y * y)) * s[2], 0,
+		t[0], t[1], t[2], 1
+	};
+}
+
+SceneGraph::SceneGraph(const Model &model, std::optional<int> scene)
+	: entries(model.nodes.size(), noParent)
+{
+	std::vector<int> roots;
+	if (!model.scenes.empty())
+	{
+		const size_t sceneIndex = scene.value_or(model.scene);
+		if (sceneIndex < model.scenes.size())
+		{
+			roots = model.scenes[sceneIndex].nodes;
+		}
+	}
+	else
+	{
+		std::vector<bool> isChild(model.nodes.size());
+		for (const Node &node : model.nodes)
+		{
+			for (int child : node.children)
+			{
+				if (child >= 0 && static_cast<size_t>(child) < isChild.size())
+				{
+					isChild[child] = true;
+				}
+			}
+		}
+		for (size_t i = 0; i < model.nodes.size(); ++i)
+		{
+			if (!isChild[i])
+			{
+				roots.push_back(static_cast<int>(i));
+			}
+		}
+	}
+
+	for (int root : roots)
+	{
+		addNode(root, noParent);
+	}
+
+	// breadth first, so each level is appended whole before the next begins
+	levels.push_back(0);
+	if (!nodes.empty())
+	{
+		levels.push_back(nodes.size());
+	}
+	for (size_t entry = 0; entry < nodes.size(); ++entry)
+	{
+		if (entry == levels.back())
+		{
+			levels.push_back(nodes.size());
+		}
+
+		childBegin.push_back(nodes.size());
+		for (int child : model.nodes[nodes[entry]].children)
+		{
+			addNode(child, static_cast<int>(entry));
+		}
+		childEnd.push_back(nodes.size());
+	}
+
+	for (size_t entry = 0; entry < nodes.size(); ++entry)
+	{
+		const Node &node = model.nodes[nodes[entry]];
+		const floatArray3 t = node.translation.value_or(floatArray3{0, 0, 0});
+		const floatArray4 r = node.rotation.value_or(floatArray4{0, 0, 0, 1});
+		const floatArray3 s = node.scale.value_or(floatArray3{1, 1, 1});
+		tx.push_back(t[0]); ty.push_back(t[1]); tz.push_back(t[2]);
+		rx.push_back(r[0]); ry.push_back(r[1]); rz.push_back(r[2]); rw.push_back(r[3]);
+		sx.push_back(s[0]); sy.push_back(s[1]); sz.push_back(s[2]);
+		hasMatrix.push_back(node.matrix.has_value());
+		locals.push_back(node.matrix.value_or(Matrix4{}));
+	}
+	worlds.resize(nodes.size());
+	dirty.resize(nodes.size());
+
+	updateAll();
+}
+
+void SceneGraph::addNode(int node, int parent)
+{
+	if (node < 0 || static_cast<size_t>(node) >= entries.size() || entries[node] != noParent)
+	{
+		return;
+	}
+	entries[node] = static_cast<int>(nodes.size());
+	nodes.push_back(node);
+	parents.push_back(parent);
+}
+
+std::optional<size_t> SceneGraph::find(int node) const
+{
+	if (node < 0 || static_cast<size_t>(node) >= entries.size() || entries[node] == noParent)
+	{
+		return std::nullopt;
+	}
+	return entries[node];
+}
+
+void SceneGraph::markDirty(size_t entry)
+{
+	if (!dirty[entry])
+	{
+		dirty[entry] = 1;
+		dirtyEntries.push_back(entry);
+	}
+}
+
+void SceneGraph::setTranslation(size_t entry, const floatArray3 &translation)
+{
+	tx[entry] = translation[0];
+	ty[entry] = translation[1];
+	tz[entry] = translation[2];
+	hasMatrix[entry] = 0;
+	markDirty(entry);
+}
+
+void SceneGraph::setRotation(size_t entry, const floatArray4 &rotation)
+{
+	rx[entry] = rotation[0];
+	ry[entry] = rotation[1];
+	rz[entry] = rotation[2];
+	rw[entry] = rotation[3];
+	hasMatrix[entry] = 0;
+	markDirty(entry);
+}
+
+void SceneGraph::setScale(size_t entry, const floatArray3 &scale)
+{
+	sx[entry] = scale[0];
+	sy[entry] = scale[1];
+	sz[entry] = scale[2];
+	hasMatrix[entry] = 0;
+	markDirty(entry);
+}
+
+void SceneGraph::setMatrix(size_t entry, const Matrix4 &matrix)
+{
+	locals[entry] = matrix;
+	hasMatrix[entry] = 1;
+	markDirty(entry);
+}
+
+void SceneGraph::computeLocals(size_t begin, size_t end)
+{
+	for (size_t entry = begin; entry < end; ++entry)
+	{
+		computeLocal(entry);
+	}
+}
+
+void SceneGraph::computeLocal(size_t entry)
+{
+	if (!hasMatrix[entry])
+	{
+		locals[entry] = composeTRS({tx[entry], ty[entry], tz[entry]},
+								   {rx[entry], ry[entry], rz[entry], rw[entry]},
+								   {sx[entry], sy[entry], sz[entry]});
+	}
+}
+
+void SceneGraph::computeWorlds(size_t begin, size_t end)
+{
+	for (size_t entry = begin; entry < end; ++entry)
+	{
+		computeWorld(entry);
+	}
+}
+
+void SceneGraph::computeWorld(size_t entry)
+{
+	const int parent = parents[entry];
+	worlds[entry] = parent == noParent ? locals[entry] : multiply(worlds[parent], locals[entry]);
+}
+
+void SceneGraph::updateAll(Executor *executor)
+{
+	parallelFor(executor, size(), parallelGrain, [this](size_t begin, size_t end)
+	{
+		computeLocals(begin, end);
+	});
+
+	// a level only depends on the one before it, so each is split on its own
+	for (size_t level = 0; level < levelCount(); ++level)
+	{
+		const size_t begin = levels[level];
+		parallelFor(executor, levels[level + 1] - begin, parallelGrain, [this, begin](size_t first, size_t last)
+		{
+			computeWorlds(begin + first, begin + last);
+		});
+	}
+
+	std::fill(dirty.begin(), dirty.end(), 0);
+	dirtyEntries.clear();
+}
+
+void SceneGraph::update(Executor *executor)
+{
+	if (dirtyEntries.size() > size() / 4)
+	{
+		updateAll(executor);
+		return;
+	}
+
+	// parents come before their children, so in entry order every dirty
+	// subtree is reached from its topmost dirty node, once
+	std::sort(dirtyEntries.begin(), dirtyEntries.end());
+	std::vector<size_t> stack;
+	for (size_t root : dirtyEntries)
+	{
+		if (!dirty[root])
+		{
+			continue;
+		}
+
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			const size_t entry = stack.back();
+			stack.pop_back();
+			if (dirty[entry])
+			{
+				computeLocal(entry);
+				dirty[entry] = 0;
+			}
+			computeWorld(entry);
+			for (size_t child = childBegin[entry]; child < childEnd[entry]; ++child)
+			{
+				stack.push_back(child);
+			}
+		}
+	}
+	dirtyEntries.clear();
+}
@@ -0,0 +1,100 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+#include "gltf.h"
+
+namespace Boiler { namespace gltf
+{
+	class Executor;
+
+	// Column-major, like glTF's node matrices.
+	using Matrix4 = std::array<float, 16>;
+
+	// One scene's node hierarchy flattened into structure-of-arrays tables in
+	// breadth-first order, so every parent comes before its children, each
+	// depth level is a contiguous range and a node's children are contiguous
+	// in the next level. Entries are addressed by their position in that
+	// order; nodeIndex maps them back to Model::nodes.
+	class SceneGraph
+	{
+		std::vector<int> nodes;
+		std::vector<int> parents;
+		std::vector<int> entries;
+		std::vector<size_t> childBegin;
+		std::vector<size_t> childEnd;
+		std::vector<size_t> levels;
+
+		// local transforms, one array per component
+		std::vector<float> tx, ty, tz;
+		std::vector<float> rx, ry, rz, rw;
+		std::vector<float> sx, sy, sz;
+		std::vector<unsigned char> hasMatrix;
+
+		std::vector<Matrix4> locals;
+		std::vector<Matrix4> worlds;
+
+		std::vector<unsigned char> dirty;
+		std::vector<size_t> dirtyEntries;
+
+		void addNode(int node, int parent);
+		void markDirty(size_t entry);
+		void computeLocals(size_t begin, size_t end);
+		void computeLocal(size_t entry);
+		void computeWorlds(size_t begin, size_t end);
+		void computeWorld(size_t entry);
+
+	public:
+		static constexpr int noParent = -1;
+
+		// Flattens the given scene, the model's default scene if not given,
+		// or every root node if the model has no scenes. Nodes reachable more
+		// than once, which glTF doesn't allow, are only added the first time.
+		explicit SceneGraph(const Model &model, std::optional<int> scene = std::nullopt);
+
+		size_t size() const { return nodes.size(); }
+		size_t levelCount() const { return levels.size() - 1; }
+		// entries [levelBegin(level), levelBegin(level + 1)) are at depth level
+		size_t levelBegin(size_t level) const { return levels[level]; }
+
+		int nodeIndex(size_t entry) const { return nodes[entry]; }
+		int parent(size_t entry) const { return parents[entry]; }
+		// entry of a Model::nodes index, if the node is in this scene
+		std::optional<size_t> find(int node) const;
+
+		std::span<const int> nodeIndices() const { return nodes; }
+		std::span<const int> parentIndices() const { return parents; }
+
+		floatArray3 translation(size_t entry) const { return {tx[entry], ty[entry], tz[entry]}; }
+		floatArray4 rotation(size_t entry) const { return {rx[entry], ry[entry], rz[entry], rw[entry]}; }
+		floatArray3 scale(size_t entry) const { return {sx[entry], sy[entry], sz[entry]}; }
+
+		// Setting any TRS component switches a node given by a matrix back to
+		// its TRS components, which start out as the identity for such nodes.
+		void setTranslation(size_t entry, const floatArray3 &translation);
+		void setRotation(size_t entry, const floatArray4 &rotation);
+		void setScale(size_t entry, const floatArray3 &scale);
+		void setMatrix(size_t entry, const Matrix4 &matrix);
+
+		const Matrix4 &localMatrix(size_t entry) const { return locals[entry]; }
+		const Matrix4 &worldMatrix(size_t entry) const { return worlds[entry]; }
+		std::span<const Matrix4> worldMatrices() const { return worlds; }
+
+		// Recomputes every local and world matrix, one level at a time, with
+		// each level split across the executor's threads when it's large.
+		void updateAll(Executor *executor = nullptr);
+		// Recomputes only the nodes changed since the last update and their
+		// descendants, falling back to updateAll when most of them changed.
+		void update(Executor *executor = nullptr);
+	};
+
+	// a * b for column-major matrices
+	Matrix4 multiply(const Matrix4 &a, const Matrix4 &b);
+	// the matrix of translation * rotation * scale
+	Matrix4 composeTRS(const floatArray3 &translation, const floatArray4 &rotation, const floatArray3 &scale);
+}}
+
+#endif /* SCENEGRAPH_H */
@@ -0,0 +1,70 @@
+#include "simd.h"
+
+#if defined(BOILER_GLTF_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+#ifdef BOILER_GLTF_X86
+	struct CPUFeatures
+	{
+		bool ssse3 = false;
+		bool sse41 = false;
+		bool avx2 = false;
+		bool fma = false;
+
+		CPUFeatures()
+		{
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+			ssse3 = (info[2] & (1 << 9)) != 0;
+			sse41 = (info[2] & (1 << 19)) != 0;
+			fma = (info[2] & (1 << 12)) != 0;
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+
+			// AVX state has to be enabled by the OS as well
+			const bool ymmEnabled = osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+			fma = fma && ymmEnabled;
+			if (maxLeaf >= 7 && ymmEnabled)
+			{
+				__cpuidex(info, 7, 0);
+				avx2 = (info[1] & (1 << 5)) != 0;
+			}
+#else
+			__builtin_cpu_init();
+			ssse3 = __builtin_cpu_supports("ssse3");
+			sse41 = __builtin_cpu_supports("sse4.1");
+			avx2 = __builtin_cpu_supports("avx2");
+			fma = __builtin_cpu_supports("fma");
+#endif
+		}
+	};
+
+	const CPUFeatures &features()
+	{
+		static const CPUFeatures cpuFeatures;
+		return cpuFeatures;
+	}
+#endif
+}
+
+namespace Boiler { namespace gltf { namespace simd
+{
+#ifdef BOILER_GLTF_X86
+	bool hasSSSE3() { return features().ssse3; }
+	bool hasSSE41() { return features().sse41; }
+	bool hasAVX2() { return features().avx2; }
+	bool hasFMA() { return features().fma; }
+#else
+	bool hasSSSE3() { return false; }
+	bool hasSSE41() { return false; }
+	bool hasAVX2() { return false; }
+	bool hasFMA() { return false; }
+#endif
+}}}
@@ -0,0 +1,33 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Helpers for runtime-dispatched SIMD kernels. Kernels are compiled for their
+// instruction set with BOILER_TARGET_* and only called after the matching
+// has*() check, so the library itself builds for the baseline ISA.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BOILER_GLTF_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BOILER_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define BOILER_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define BOILER_TARGET_AVX2 __attribute__((target("avx2")))
+#define BOILER_TARGET_AVX2_FMA __attribute__((target("avx2,fma")))
+#else
+#define BOILER_TARGET_SSSE3
+#define BOILER_TARGET_SSE41
+#define BOILER_TARGET_AVX2
+#define BOILER_TARGET_AVX2_FMA
+#endif
+
+namespace Boiler { namespace gltf { namespace simd
+{
+	bool hasSSSE3();
+	bool hasSSE41();
+	bool hasAVX2();
+	bool hasFMA();
+}}}
+
+#endif /* SIMD_H */
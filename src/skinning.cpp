@@ -0,0 +1,323 @@
+#include <cmath>
+#include <string>
+#include "modelaccessors.h"
+#include "simd.h"
+#include "skinning.h"
+#include "threadpool.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	// vertices per task when skinning across threads
+	constexpr size_t parallelGrain = 8192;
+
+	struct SkinInputs
+	{
+		const float *positions[3];
+		const float *normals[3];
+		const uint32_t *joints;
+		const float *weights;
+		size_t vertexCount;
+		size_t influenceCount;
+		const float *jointMatrices;
+		float *positionsOut;
+		float *normalsOut;
+	};
+
+	// The blended matrix's first three rows, column by column, are
+	// m[column * 3 + row].
+	void skinScalar(const SkinInputs &in, size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; ++v)
+		{
+			float m[12] = {};
+			for (size_t i = 0; i < in.influenceCount; ++i)
+			{
+				const float weight = in.weights[i * in.vertexCount + v];
+				if (weight == 0)
+				{
+					continue;
+				}
+				const float *joint = in.jointMatrices + in.joints[i * in.vertexCount + v] * 16;
+				for (int column = 0; column < 4; ++column)
+				{
+					for (int row = 0; row < 3; ++row)
+					{
+						m[column * 3 + row] += weight * joint[column * 4 + row];
+					}
+				}
+			}
+
+			const float x = in.positions[0][v], y = in.positions[1][v], z = in.positions[2][v];
+			for (int row = 0; row < 3; ++row)
+			{
+				in.positionsOut[v * 3 + row] = m[row] * x + m[3 + row] * y + m[6 + row] * z + m[9 + row];
+			}
+
+			if (in.normalsOut)
+			{
+				const float nx = in.normals[0][v], ny = in.normals[1][v], nz = in.normals[2][v];
+				float normal[3];
+				for (int row = 0; row < 3; ++row)
+				{
+					normal[row] = m[row] * nx + m[3 + row] * ny + m[6 + row] * nz;
+				}
+				const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				const float scale = length > 0 ? 1 / length : 0;
+				for (int row = 0; row < 3; ++row)
+				{
+					in.normalsOut[v * 3 + row] = normal[row] * scale;
+				}
+			}
+		}
+	}
+
+#ifdef BOILER_GLTF_X86
+	// Eight vertices at a time, one per lane, gathering each lane's joint
+	// matrix elements. Influences that are zero for all eight are skipped.
+	BOILER_TARGET_AVX2_FMA size_t skinAVX2(const SkinInputs &in, size_t begin, size_t end)
+	{
+		size_t v = begin;
+		for (; v + 8 <= end; v += 8)
+		{
+			__m256 m[12];
+			for (__m256 &element : m)
+			{
+				element = _mm256_setzero_ps();
+			}
+
+			for (size_t i = 0; i < in.influenceCount; ++i)
+			{
+				const __m256 weight = _mm256_loadu_ps(in.weights + i * in.vertexCount + v);
+				if (_mm256_movemask_ps(_mm256_cmp_ps(weight, _mm256_setzero_ps(), _CMP_NEQ_UQ)) == 0)
+				{
+					continue;
+				}
+				const __m256i joint = _mm256_slli_epi32(
+					_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in.joints + i * in.vertexCount + v)), 4);
+				for (int column = 0; column < 4; ++column)
+				{
+					for (int row = 0; row < 3; ++row)
+					{
+						const __m256 element = _mm256_i32gather_ps(in.jointMatrices + column * 4 + row, joint, 4);
+						m[column * 3 + row] = _mm256_fmadd_ps(weight, element, m[column * 3 + row]);
+					}
+				}
+			}
+
+			alignas(32) float out[3][8];
+			const __m256 x = _mm256_loadu_ps(in.positions[0] + v);
+			const __m256 y = _mm256_loadu_ps(in.positions[1] + v);
+			const __m256 z = _mm256_loadu_ps(in.positions[2] + v);
+			for (int row = 0; row < 3; ++row)
+			{
+				__m256 value = _mm256_fmadd_ps(m[row], x, m[9 + row]);
+				value = _mm256_fmadd_ps(m[3 + row], y, value);
+				value = _mm256_fmadd_ps(m[6 + row], z, value);
+				_mm256_store_ps(out[row], value);
+			}
+			for (int lane = 0; lane < 8; ++lane)
+			{
+				for (int row = 0; row < 3; ++row)
+				{
+					in.positionsOut[(v + lane) * 3 + row] = out[row][lane];
+				}
+			}
+
+			if (in.normalsOut)
+			{
+				const __m256 nx = _mm256_loadu_ps(in.normals[0] + v);
+				const __m256 ny = _mm256_loadu_ps(in.normals[1] + v);
+				const __m256 nz = _mm256_loadu_ps(in.normals[2] + v);
+				__m256 normal[3];
+				for (int row = 0; row < 3; ++row)
+				{
+					normal[row] = _mm256_mul_ps(m[row], nx);
+					normal[row] = _mm256_fmadd_ps(m[3 + row], ny, normal[row]);
+					normal[row] = _mm256_fmadd_ps(m[6 + row], nz, normal[row]);
+				}
+				__m256 length = _mm256_mul_ps(normal[0], normal[0]);
+				length = _mm256_fmadd_ps(normal[1], normal[1], length);
+				length = _mm256_fmadd_ps(normal[2], normal[2], length);
+				length = _mm256_sqrt_ps(length);
+				// zero length normals stay zero rather than becoming NaN
+				const __m256 nonZero = _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ);
+				const __m256 scale = _mm256_and_ps(_mm256_div_ps(_mm256_set1_ps(1.0f), length), nonZero);
+				for (int row = 0; row < 3; ++row)
+				{
+					_mm256_store_ps(out[row], _mm256_mul_ps(normal[row], scale));
+				}
+				for (int lane = 0; lane < 8; ++lane)
+				{
+					for (int row = 0; row < 3; ++row)
+					{
+						in.normalsOut[(v + lane) * 3 + row] = out[row][lane];
+					}
+				}
+			}
+		}
+		return v;
+	}
+#endif
+
+	// splits packed x, y, z triples into one array per component
+	void splitComponents(const std::vector<float> &packed, size_t count, std::vector<float> (&out)[3])
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			out[c].resize(count);
+			for (size_t v = 0; v < count; ++v)
+			{
+				out[c][v] = packed[v * 3 + c];
+			}
+		}
+	}
+}
+
+std::optional<SkinBinding> SkinBinding::resolve(const ModelAccessors &accessors, const Skin &skin, const SceneGraph &scene)
+{
+	SkinBinding binding;
+	binding.joints.reserve(skin.joints.size());
+	for (int joint : skin.joints)
+	{
+		const std::optional<size_t> entry = scene.find(joint);
+		if (!entry.has_value())
+		{
+			return std::nullopt;
+		}
+		binding.joints.push_back(entry.value());
+	}
+
+	// without inverse bind matrices they're all the identity
+	binding.inverseBindMatrices.assign(skin.joints.size(), Matrix4{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1});
+	if (skin.inverseBindMatrices.has_value())
+	{
+		const Model &model = accessors.getModel();
+		const size_t index = skin.inverseBindMatrices.value();
+		if (index >= model.accessors.size() || model.accessors[index].type != AccessorType::MAT4
+			|| model.accessors[index].count < skin.joints.size())
+		{
+			return std::nullopt;
+		}
+
+		std::vector<float> matrices(static_cast<size_t>(model.accessors[index].count) * 16);
+		accessors.readAccessor(model.accessors[index], std::span<float>(matrices));
+		for (size_t i = 0; i < binding.inverseBindMatrices.size(); ++i)
+		{
+			std::copy_n(matrices.data() + i * 16, 16, binding.inverseBindMatrices[i].data());
+		}
+	}
+	return binding;
+}
+
+void SkinBinding::computeJointMatrices(const SceneGraph &scene, std::span<Matrix4> out) const
+{
+	const size_t count = std::min(out.size(), joints.size());
+	for (size_t i = 0; i < count; ++i)
+	{
+		out[i] = multiply(scene.worldMatrix(joints[i]), inverseBindMatrices[i]);
+	}
+}
+
+std::optional<SkinnedPrimitive> SkinnedPrimitive::resolve(const ModelAccessors &accessors, const Primitive &primitive)
+{
+	const Model &model = accessors.getModel();
+	auto findAccessor = [&](const auto &attribute) -> const Accessor *
+	{
+		const std::optional<int> found = primitive.attributes.find(attribute);
+		if (!found.has_value() || static_cast<size_t>(*found) >= model.accessors.size())
+		{
+			return nullptr;
+		}
+		return &model.accessors[*found];
+	};
+
+	const Accessor *position = findAccessor(Attribute::POSITION);
+	if (!position || componentCount(position->type) != 3)
+	{
+		return std::nullopt;
+	}
+
+	SkinnedPrimitive skinned;
+	skinned.vertexCount = position->count;
+	std::vector<float> packed(skinned.vertexCount * 3);
+	accessors.readAccessor(*position, std::span<float>(packed));
+	splitComponents(packed, skinned.vertexCount, skinned.positions);
+
+	const Accessor *normal = findAccessor(Attribute::NORMAL);
+	if (normal && normal->count == skinned.vertexCount && componentCount(normal->type) == 3)
+	{
+		accessors.readAccessor(*normal, std::span<float>(packed));
+		splitComponents(packed, skinned.vertexCount, skinned.normals);
+	}
+
+	// JOINTS_n are unsigned bytes or shorts, WEIGHTS_n floats or normalized
+	// unsigned bytes or shorts; readAccessor widens and normalizes them all
+	std::vector<uint32_t> jointSet(skinned.vertexCount * 4);
+	std::vector<float> weightSet(skinned.vertexCount * 4);
+	for (unsigned int set = 0;; ++set)
+	{
+		// the first sets have slots, any further ones are in the side table
+		const Accessor *joints = findAccessor("JOINTS_" + std::to_string(set));
+		const Accessor *weights = findAccessor("WEIGHTS_" + std::to_string(set));
+		if (!joints || !weights)
+		{
+			break;
+		}
+		if (joints->count != skinned.vertexCount || weights->count != skinned.vertexCount
+			|| joints->type != AccessorType::VEC4 || weights->type != AccessorType::VEC4)
+		{
+			return std::nullopt;
+		}
+
+		accessors.readAccessor(*joints, std::span<uint32_t>(jointSet));
+		accessors.readAccessor(*weights, std::span<float>(weightSet));
+		for (size_t i = 0; i < 4; ++i)
+		{
+			for (size_t v = 0; v < skinned.vertexCount; ++v)
+			{
+				const uint32_t joint = jointSet[v * 4 + i];
+				skinned.joints.push_back(joint);
+				skinned.weights.push_back(weightSet[v * 4 + i]);
+				skinned.maxJoint = std::max(skinned.maxJoint, joint);
+			}
+		}
+		skinned.influenceCount += 4;
+	}
+
+	if (skinned.influenceCount == 0)
+	{
+		return std::nullopt;
+	}
+	return skinned;
+}
+
+bool SkinnedPrimitive::skin(std::span<const Matrix4> jointMatrices, std::span<float> positionsOut,
+							std::span<float> normalsOut, Executor *executor) const
+{
+	if (maxJoint >= jointMatrices.size() || positionsOut.size() < vertexCount * 3
+		|| (!normalsOut.empty() && (!hasNormals() || normalsOut.size() < vertexCount * 3)))
+	{
+		return false;
+	}
+
+	const SkinInputs in{
+		{positions[0].data(), positions[1].data(), positions[2].data()},
+		{normals[0].data(), normals[1].data(), normals[2].data()},
+		joints.data(), weights.data(), vertexCount, influenceCount,
+		jointMatrices.data()->data(), positionsOut.data(), normalsOut.empty() ? nullptr : normalsOut.data()
+	};
+
+	parallelFor(executor, vertexCount, parallelGrain, [&in](size_t begin, size_t end)
+	{
+#ifdef BOILER_GLTF_X86
+		if (simd::hasAVX2() && simd::hasFMA())
+		{
+			begin = skinAVX2(in, begin, end);
+		}
+#endif
+		skinScalar(in, begin, end);
+	});
+	return true;
+}
@@ -0,0 +1,70 @@
+#ifndef SKINNING_H
+#define SKINNING_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "gltf.h"
+#include "scenegraph.h"
+
+namespace Boiler { namespace gltf
+{
+	class Executor;
+	class ModelAccessors;
+
+	// A skin's joints located in a SceneGraph, with its inverse bind matrices
+	// read once.
+	class SkinBinding
+	{
+		std::vector<size_t> joints;
+		std::vector<Matrix4> inverseBindMatrices;
+
+	public:
+		// Returns nullopt if a joint isn't in the scene or the inverse bind
+		// matrices aren't one MAT4 per joint.
+		static std::optional<SkinBinding> resolve(const ModelAccessors &accessors, const Skin &skin, const SceneGraph &scene);
+
+		size_t jointCount() const { return joints.size(); }
+
+		// Each joint's world matrix times its inverse bind matrix, which takes
+		// bind pose vertices straight to world space. glTF ignores the skinned
+		// mesh node's own transform.
+		void computeJointMatrices(const SceneGraph &scene, std::span<Matrix4> out) const;
+	};
+
+	// A primitive's bind pose and joint influences converted once to floats
+	// and 32-bit joint indices, one array per component, so skinning is a
+	// straight pass over the vertices.
+	class SkinnedPrimitive
+	{
+		size_t vertexCount = 0;
+		// influences per vertex: four for each JOINTS_n/WEIGHTS_n pair
+		size_t influenceCount = 0;
+		uint32_t maxJoint = 0;
+		std::vector<float> positions[3];
+		std::vector<float> normals[3];
+		// influence i of vertex v is at i * vertexCount + v
+		std::vector<uint32_t> joints;
+		std::vector<float> weights;
+
+	public:
+		// Reads POSITION, NORMAL if present, and every JOINTS_n/WEIGHTS_n pair
+		// in any of their allowed component types. Returns nullopt without
+		// POSITION, JOINTS_0 and WEIGHTS_0 or if their counts differ.
+		static std::optional<SkinnedPrimitive> resolve(const ModelAccessors &accessors, const Primitive &primitive);
+
+		size_t size() const { return vertexCount; }
+		bool hasNormals() const { return !normals[0].empty(); }
+
+		// Linear blend skinning: writes each vertex's packed x, y, z position,
+		// and normal if normalsOut isn't empty, blended over its influences.
+		// Large primitives are split across the executor's threads. Returns
+		// false if an output is too small or a joint index is out of range
+		// of jointMatrices.
+		bool skin(std::span<const Matrix4> jointMatrices, std::span<float> positionsOut,
+				  std::span<float> normalsOut = {}, Executor *executor = nullptr) const;
+	};
+}}
+
+#endif /* SKINNING_H */
@@ -0,0 +1,153 @@
+#ifndef SPARSEACCESSOR_H
+#define SPARSEACCESSOR_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include "gltf.h"
+#include "convert.h"
+
+namespace Boiler { namespace gltf
+{
+	// Lazy view of a sparse accessor. Elements named by the sparse indices come
+	// from the sparse values and all others from the base data, which is zeros
+	// when the accessor has no bufferView. Nothing is copied or allocated.
+	// Iteration is O(1) per element, random access is a binary search over the
+	// sparse indices.
+	template<typename ComponentType, unsigned short NumComponents>
+	class SparseAccessor
+	{
+		static constexpr std::array<ComponentType, NumComponents> zeros{};
+
+		const std::byte *base;
+		std::ptrdiff_t stride;
+		const std::byte *indices;
+		gltf::ComponentType indexType;
+		const std::byte *values;
+		size_t sparseCount;
+
+		size_t indexAt(size_t i) const
+		{
+			switch (indexType)
+			{
+				case gltf::ComponentType::UNSIGNED_BYTE: return convert::load<uint8_t>(indices + i);
+				case gltf::ComponentType::UNSIGNED_SHORT: return convert::load<uint16_t>(indices + i * 2);
+				default: return convert::load<uint32_t>(indices + i * 4);
+			}
+		}
+
+		const ComponentType *valueAt(size_t i) const
+		{
+			return reinterpret_cast<const ComponentType *>(values + i * sizeof(ComponentType) * NumComponents);
+		}
+
+		const ComponentType *baseAt(size_t index) const
+		{
+			return base ? reinterpret_cast<const ComponentType *>(base + index * stride) : zeros.data();
+		}
+
+	public:
+		class SparseIterator
+		{
+			const SparseAccessor *sparseAccessor;
+			size_t position;
+			size_t cursor; // first sparse entry whose index is >= position
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = const ComponentType *;
+			using difference_type = std::ptrdiff_t;
+			using reference = const ComponentType *;
+			using pointer = void;
+
+			SparseIterator() : sparseAccessor(nullptr), position(0), cursor(0)
+			{
+			}
+
+			SparseIterator(const SparseAccessor *sparseAccessor, size_t position, size_t cursor)
+				: sparseAccessor(sparseAccessor), position(position), cursor(cursor)
+			{
+			}
+
+			const ComponentType *operator*() const
+			{
+				if (cursor < sparseAccessor->sparseCount && sparseAccessor->indexAt(cursor) == position)
+				{
+					return sparseAccessor->valueAt(cursor);
+				}
+				return sparseAccessor->baseAt(position);
+			}
+
+			SparseIterator &operator++()
+			{
+				++position;
+				while (cursor < sparseAccessor->sparseCount && sparseAccessor->indexAt(cursor) < position)
+				{
+					++cursor;
+				}
+				return *this;
+			}
+
+			SparseIterator operator++(int)
+			{
+				SparseIterator previous = *this;
+				++*this;
+				return previous;
+			}
+
+			bool operator==(const SparseIterator &other) const { return position == other.position; }
+		};
+
+		const Accessor &accessor;
+
+		// base is null when the accessor has no bufferView
+		SparseAccessor(const Accessor &accessor, const std::byte *base, std::ptrdiff_t stride,
+					   const std::byte *indices, const std::byte *values)
+			: base(base), stride(stride), indices(indices),
+			  indexType(accessor.sparse.has_value() ? accessor.sparse->indices.componentType
+						: gltf::ComponentType::UNSIGNED_INT),
+			  values(values), sparseCount(accessor.sparse.has_value() ? accessor.sparse->count : 0),
+			  accessor(accessor)
+		{
+		}
+
+		const ComponentType *operator[](size_t index) const
+		{
+			size_t low = 0, high = sparseCount;
+			while (low < high)
+			{
+				const size_t middle = low + (high - low) / 2;
+				if (indexAt(middle) < index)
+				{
+					low = middle + 1;
+				}
+				else
+				{
+					high = middle;
+				}
+			}
+
+			if (low < sparseCount && indexAt(low) == index)
+			{
+				return valueAt(low);
+			}
+			return baseAt(index);
+		}
+
+		SparseIterator begin() const
+		{
+			return SparseIterator(this, 0, 0);
+		}
+
+		SparseIterator end() const
+		{
+			return SparseIterator(this, accessor.count, sparseCount);
+		}
+
+		size_t size() const { return accessor.count; }
+		size_t sparseSize() const { return sparseCount; }
+	};
+}}
+
+#endif /* SPARSEACCESSOR_H */
@@ -0,0 +1,628 @@
+#include <rapidjson/reader.h>
+#include "gltf.h"
+#include "loadstats.h"
+
+namespace Boiler { namespace gltf
+{
+	namespace
+	{
+		// Where the handler is in the document. Arrays of objects get their own
+		// state so an element knows which model vector it belongs to.
+		enum class State
+		{
+			Root,
+			Asset,
+			Scenes, Scene,
+			Nodes, Node,
+			Meshes, Mesh, Primitives, Primitive, Attributes, Targets, MorphTarget,
+			Accessors, Accessor, Sparse, SparseIndices, SparseValues,
+			Buffers, Buffer,
+			BufferViews, BufferView,
+			Materials, Material, PBR, MaterialTexture,
+			Images, Image,
+			Textures, Texture,
+			Animations, Animation, AnimationSamplers, AnimationSampler,
+			Channels, Channel, ChannelTarget,
+			Skins, Skin,
+			IntArray, FloatArray, FloatList, ValueArray,
+			Skip
+		};
+
+		AccessorType toAccessorType(std::string_view type)
+		{
+			if (type == "SCALAR") return AccessorType::SCALAR;
+			if (type == "VEC2") return AccessorType::VEC2;
+			if (type == "VEC4") return AccessorType::VEC4;
+			if (type == "MAT2") return AccessorType::MAT2;
+			if (type == "MAT3") return AccessorType::MAT3;
+			if (type == "MAT4") return AccessorType::MAT4;
+			return AccessorType::VEC3;
+		}
+
+		Interpolation toInterpolation(std::string_view interpolation)
+		{
+			if (interpolation == "STEP") return Interpolation::STEP;
+			if (interpolation == "CUBICSPLINE") return Interpolation::CUBICSPLINE;
+			return Interpolation::LINEAR;
+		}
+
+		// Fills a Model straight from rapidjson's SAX events. Field defaults
+		// follow load() exactly, so both paths produce equal models.
+		class ModelHandler : public BaseReaderHandler<UTF8<>, ModelHandler>
+		{
+			Model &model;
+			std::vector<State> stack;
+			// parsing is in place, so keys and strings stay valid in the model's storage
+			std::string_view key;
+			unsigned int skipDepth = 0;
+			bool hasScene = false;
+
+			// targets of the generic array states
+			std::vector<int> *intArray = nullptr;
+			std::vector<float> *floatList = nullptr;
+			std::vector<AccessorValue> *valueArray = nullptr;
+			float *floatArray = nullptr;
+			size_t floatArraySize = 0, floatArrayIndex = 0;
+			std::optional<MaterialTexture> *materialTexture = nullptr;
+
+			// samplers and channels have no default state, so they're collected first
+			unsigned int samplerInput = 0, samplerOutput = 0;
+			Interpolation samplerInterpolation = Interpolation::LINEAR;
+			unsigned int channelSampler = 0;
+			Target channelTarget;
+
+			State top() const { return stack.back(); }
+
+			template<size_t Size>
+			void beginFloatArray(std::optional<std::array<float, Size>> &target)
+			{
+				target = std::array<float, Size>{};
+				floatArray = target->data();
+				floatArraySize = Size;
+				floatArrayIndex = 0;
+				stack.push_back(State::FloatArray);
+			}
+
+			void beginIntArray(std::vector<int> &target)
+			{
+				intArray = &target;
+				stack.push_back(State::IntArray);
+			}
+
+			void beginFloatList(std::vector<float> &target)
+			{
+				floatList = &target;
+				stack.push_back(State::FloatList);
+			}
+
+			void beginValueArray(std::vector<AccessorValue> &target)
+			{
+				valueArray = &target;
+				stack.push_back(State::ValueArray);
+			}
+
+			bool skip()
+			{
+				stack.push_back(State::Skip);
+				skipDepth = 1;
+				return true;
+			}
+
+			bool number(double value)
+			{
+				if (stack.empty())
+				{
+					return false;
+				}
+
+				const int intValue = static_cast<int>(value);
+				const float floatValue = static_cast<float>(value);
+
+				switch (top())
+				{
+					case State::Skip:
+						break;
+					case State::Root:
+						if (key == "scene")
+						{
+							model.scene = intValue;
+							hasScene = true;
+						}
+						break;
+					case State::IntArray:
+						intArray->push_back(intValue);
+						break;
+					case State::FloatArray:
+						if (floatArrayIndex < floatArraySize)
+						{
+							floatArray[floatArrayIndex++] = floatValue;
+						}
+						break;
+					case State::FloatList:
+						floatList->push_back(floatValue);
+						break;
+					case State::ValueArray:
+						valueArray->push_back(AccessorValue(floatValue));
+						break;
+					case State::Node:
+						if (key == "mesh") model.nodes.back().mesh = intValue;
+						else if (key == "skin") model.nodes.back().skin = intValue;
+						break;
+					case State::Primitive:
+					{
+						Primitive &primitive = model.meshes.back().primitives.back();
+						if (key == "indices") primitive.indices = intValue;
+						else if (key == "mode") primitive.mode = intValue;
+						else if (key == "material") primitive.material = intValue;
+						break;
+					}
+					case State::Attributes:
+						model.meshes.back().primitives.back().attributes.set(key, intValue);
+						break;
+					case State::MorphTarget:
+						model.meshes.back().primitives.back().targets.back().set(key, intValue);
+						break;
+					case State::Accessor:
+					{
+						Accessor &accessor = model.accessors.back();
+						if (key == "bufferView") accessor.bufferView = intValue;
+						else if (key == "byteOffset") accessor.byteOffset = intValue;
+						else if (key == "componentType") accessor.componentType = static_cast<ComponentType>(intValue);
+						else if (key == "count") accessor.count = intValue;
+						break;
+					}
+					case State::Sparse:
+						if (key == "count") model.accessors.back().sparse->count = intValue;
+						break;
+					case State::SparseIndices:
+					{
+						SparseIndices &indices = model.accessors.back().sparse->indices;
+						if (key == "bufferView") indices.bufferView = intValue;
+						else if (key == "byteOffset") indices.byteOffset = intValue;
+						else if (key == "componentType") indices.componentType = static_cast<ComponentType>(intValue);
+						break;
+					}
+					case State::SparseValues:
+					{
+						SparseValues &values = model.accessors.back().sparse->values;
+						if (key == "bufferView") values.bufferView = intValue;
+						else if (key == "byteOffset") values.byteOffset = intValue;
+						break;
+					}
+					case State::Buffer:
+						if (key == "byteLength") model.buffers.back().byteLength = intValue;
+						break;
+					case State::BufferView:
+					{
+						BufferView &bufferView = model.bufferViews.back();
+						if (key == "buffer") bufferView.buffer = intValue;
+						else if (key == "byteOffset") bufferView.byteOffset = intValue;
+						else if (key == "byteLength") bufferView.byteLength = intValue;
+						else if (key == "byteStride") bufferView.byteStride = intValue;
+						else if (key == "target") bufferView.target = intValue;
+						break;
+					}
+					case State::Material:
+						if (key == "alphaCutoff") model.materials.back().alphaCutoff = floatValue;
+						break;
+					case State::PBR:
+					{
+						PBRMetallicRoughness &pbr = model.materials.back().pbrMetallicRoughness.value();
+						if (key == "metallicFactor") pbr.metallicFactor = floatValue;
+						else if (key == "roughnessFactor") pbr.roughnessFactor = floatValue;
+						break;
+					}
+					case State::MaterialTexture:
+					{
+						MaterialTexture &texture = materialTexture->value();
+						if (key == "index") texture.index = intValue;
+						else if (key == "texCoord") texture.texCoord = intValue;
+						else if (key == "scale") texture.scale = floatValue;
+						break;
+					}
+					case State::Image:
+						if (key == "bufferView") model.images.back().bufferView = intValue;
+						break;
+					case State::Texture:
+					{
+						Texture &texture = model.textures.back();
+						if (key == "sampler") texture.sampler = intValue;
+						else if (key == "source") texture.source = intValue;
+						break;
+					}
+					case State::AnimationSampler:
+						if (key == "input") samplerInput = intValue;
+						else if (key == "output") samplerOutput = intValue;
+						break;
+					case State::Channel:
+						if (key == "sampler") channelSampler = intValue;
+						break;
+					case State::ChannelTarget:
+						if (key == "node") channelTarget.node = intValue;
+						break;
+					case State::Skin:
+						if (key == "inverseBindMatrices") model.skins.back().inverseBindMatrices = intValue;
+						else if (key == "skeleton") model.skins.back().skeleton = intValue;
+						break;
+					default:
+						break;
+				}
+				return true;
+			}
+
+		public:
+			explicit ModelHandler(Model &model) : model(model)
+			{
+			}
+
+			bool Null() { return true; }
+			bool Bool(bool value)
+			{
+				if (stack.empty())
+				{
+					return false;
+				}
+				if (top() == State::Material && key == "doubleSided")
+				{
+					model.materials.back().doubleSided = value;
+				}
+				else if (top() == State::Accessor && key == "normalized")
+				{
+					model.accessors.back().normalized = value;
+				}
+				return true;
+			}
+			bool Int(int value) { return number(value); }
+			bool Uint(unsigned value) { return number(value); }
+			bool Int64(int64_t value) { return number(static_cast<double>(value)); }
+			bool Uint64(uint64_t value) { return number(static_cast<double>(value)); }
+			bool Double(double value) { return number(value); }
+
+			bool String(const char *str, SizeType length, bool)
+			{
+				if (stack.empty())
+				{
+					return false;
+				}
+
+				const std::string_view value(str, length);
+				switch (top())
+				{
+					case State::Asset:
+						if (key == "version") model.asset.version = value;
+						else if (key == "generator") model.asset.generator = value;
+						else if (key == "copyright") model.asset.copyright = value;
+						break;
+					case State::Node:
+						if (key == "name") model.nodes.back().name = value;
+						break;
+					case State::Mesh:
+						if (key == "name") model.meshes.back().name = value;
+						break;
+					case State::Accessor:
+						if (key == "type") model.accessors.back().type = toAccessorType(value);
+						else if (key == "name") model.accessors.back().name = value;
+						break;
+					case State::Buffer:
+						if (key == "uri") model.buffers.back().uri = value;
+						else if (key == "name") model.buffers.back().name = value;
+						break;
+					case State::BufferView:
+						if (key == "name") model.bufferViews.back().name = value;
+						break;
+					case State::Material:
+						if (key == "name") model.materials.back().name = value;
+						else if (key == "alphaMode") model.materials.back().alphaMode = value;
+						break;
+					case State::Image:
+						if (key == "uri") model.images.back().uri = value;
+						else if (key == "mimeType") model.images.back().mimeType = value;
+						else if (key == "name") model.images.back().name = value;
+						break;
+					case State::Texture:
+						if (key == "name") model.textures.back().name = value;
+						break;
+					case State::Animation:
+						if (key == "name") model.animations.back().name = value;
+						break;
+					case State::AnimationSampler:
+						if (key == "interpolation") samplerInterpolation = toInterpolation(value);
+						break;
+					case State::ChannelTarget:
+						if (key == "path") channelTarget.path = value;
+						break;
+					case State::Skin:
+						if (key == "name") model.skins.back().name = value;
+						break;
+					default:
+						break;
+				}
+				return true;
+			}
+
+			bool Key(const char *str, SizeType length, bool)
+			{
+				key = std::string_view(str, length);
+				return true;
+			}
+
+			bool StartObject()
+			{
+				if (stack.empty())
+				{
+					stack.push_back(State::Root);
+					return true;
+				}
+
+				switch (top())
+				{
+					case State::Skip:
+						++skipDepth;
+						return true;
+					case State::Root:
+						if (key == "asset") stack.push_back(State::Asset);
+						else return skip();
+						return true;
+					case State::Scenes:
+						model.scenes.emplace_back();
+						stack.push_back(State::Scene);
+						return true;
+					case State::Nodes:
+						model.nodes.emplace_back();
+						stack.push_back(State::Node);
+						return true;
+					case State::Meshes:
+						model.meshes.emplace_back();
+						stack.push_back(State::Mesh);
+						return true;
+					case State::Primitives:
+						model.meshes.back().primitives.emplace_back();
+						stack.push_back(State::Primitive);
+						return true;
+					case State::Primitive:
+						if (key == "attributes") stack.push_back(State::Attributes);
+						else return skip();
+						return true;
+					case State::Targets:
+						model.meshes.back().primitives.back().targets.emplace_back();
+						stack.push_back(State::MorphTarget);
+						return true;
+					case State::Accessors:
+						// load() defaults a missing type to VEC3
+						model.accessors.emplace_back().type = AccessorType::VEC3;
+						stack.push_back(State::Accessor);
+						return true;
+					case State::Accessor:
+						if (key == "sparse")
+						{
+							model.accessors.back().sparse = Sparse();
+							stack.push_back(State::Sparse);
+						}
+						else return skip();
+						return true;
+					case State::Sparse:
+						if (key == "indices") stack.push_back(State::SparseIndices);
+						else if (key == "values") stack.push_back(State::SparseValues);
+						else return skip();
+						return true;
+					case State::Buffers:
+						model.buffers.emplace_back(0);
+						stack.push_back(State::Buffer);
+						return true;
+					case State::BufferViews:
+						model.bufferViews.emplace_back();
+						stack.push_back(State::BufferView);
+						return true;
+					case State::Materials:
+					{
+						// load() leaves factors that aren't in the file empty
+						Material &material = model.materials.emplace_back();
+						material.emissiveFactor.reset();
+						stack.push_back(State::Material);
+						return true;
+					}
+					case State::Material:
+					{
+						Material &material = model.materials.back();
+						if (key == "pbrMetallicRoughness")
+						{
+							material.pbrMetallicRoughness = PBRMetallicRoughness();
+							material.pbrMetallicRoughness->baseColorFactor.reset();
+							stack.push_back(State::PBR);
+							return true;
+						}
+
+						if (key == "normalTexture") materialTexture = &material.normalTexture;
+						else if (key == "occlusionTexture") materialTexture = &material.occlusionTexture;
+						else if (key == "emissiveTexture") materialTexture = &material.emissiveTexture;
+						else return skip();
+
+						*materialTexture = MaterialTexture();
+						stack.push_back(State::MaterialTexture);
+						return true;
+					}
+					case State::PBR:
+					{
+						PBRMetallicRoughness &pbr = model.materials.back().pbrMetallicRoughness.value();
+						if (key == "baseColorTexture") materialTexture = &pbr.baseColorTexture;
+						else if (key == "metallicRoughnessTexture") materialTexture = &pbr.metallicRoughnessTexture;
+						else return skip();
+
+						*materialTexture = MaterialTexture();
+						stack.push_back(State::MaterialTexture);
+						return true;
+					}
+					case State::Images:
+						model.images.emplace_back();
+						stack.push_back(State::Image);
+						return true;
+					case State::Textures:
+						model.textures.emplace_back();
+						stack.push_back(State::Texture);
+						return true;
+					case State::Animations:
+						model.animations.emplace_back();
+						stack.push_back(State::Animation);
+						return true;
+					case State::AnimationSamplers:
+						samplerInput = samplerOutput = 0;
+						samplerInterpolation = Interpolation::LINEAR;
+						stack.push_back(State::AnimationSampler);
+						return true;
+					case State::Channels:
+						channelSampler = 0;
+						channelTarget = Target();
+						stack.push_back(State::Channel);
+						return true;
+					case State::Channel:
+						if (key == "target") stack.push_back(State::ChannelTarget);
+						else return skip();
+						return true;
+					case State::Skins:
+						model.skins.emplace_back();
+						stack.push_back(State::Skin);
+						return true;
+					default:
+						return skip();
+				}
+			}
+
+			bool EndObject(SizeType)
+			{
+				const State state = top();
+				if (state == State::Skip && --skipDepth > 0)
+				{
+					return true;
+				}
+				stack.pop_back();
+
+				if (state == State::AnimationSampler)
+				{
+					model.animations.back().samplers.push_back(
+						Sampler(samplerInput, samplerOutput, samplerInterpolation));
+				}
+				else if (state == State::Channel)
+				{
+					model.animations.back().channels.push_back(Channel(channelSampler, channelTarget));
+				}
+				else if (state == State::Root && !hasScene)
+				{
+					// load() only reads scenes when a default scene is given
+					model.scenes.clear();
+				}
+				return true;
+			}
+
+			bool StartArray()
+			{
+				if (stack.empty())
+				{
+					return false;
+				}
+
+				switch (top())
+				{
+					case State::Skip:
+						++skipDepth;
+						return true;
+					case State::Root:
+						if (key == "scenes") stack.push_back(State::Scenes);
+						else if (key == "nodes") stack.push_back(State::Nodes);
+						else if (key == "meshes") stack.push_back(State::Meshes);
+						else if (key == "accessors") stack.push_back(State::Accessors);
+						else if (key == "buffers") stack.push_back(State::Buffers);
+						else if (key == "bufferViews") stack.push_back(State::BufferViews);
+						else if (key == "materials") stack.push_back(State::Materials);
+						else if (key == "images") stack.push_back(State::Images);
+						else if (key == "textures") stack.push_back(State::Textures);
+						else if (key == "animations") stack.push_back(State::Animations);
+						else if (key == "skins") stack.push_back(State::Skins);
+						else return skip();
+						return true;
+					case State::Scene:
+						if (key == "nodes") beginIntArray(model.scenes.back().nodes);
+						else return skip();
+						return true;
+					case State::Node:
+					{
+						Node &node = model.nodes.back();
+						if (key == "children") beginIntArray(node.children);
+						else if (key == "matrix") beginFloatArray(node.matrix);
+						else if (key == "translation") beginFloatArray(node.translation);
+						else if (key == "rotation") beginFloatArray(node.rotation);
+						else if (key == "scale") beginFloatArray(node.scale);
+						else return skip();
+						return true;
+					}
+					case State::Mesh:
+						if (key == "primitives") stack.push_back(State::Primitives);
+						else if (key == "weights") beginFloatList(model.meshes.back().weights);
+						else return skip();
+						return true;
+					case State::Primitive:
+						if (key == "targets") stack.push_back(State::Targets);
+						else return skip();
+						return true;
+					case State::Accessor:
+						if (key == "min") beginValueArray(model.accessors.back().min);
+						else if (key == "max") beginValueArray(model.accessors.back().max);
+						else return skip();
+						return true;
+					case State::Material:
+						if (key == "emissiveFactor") beginFloatArray(model.materials.back().emissiveFactor);
+						else return skip();
+						return true;
+					case State::PBR:
+						if (key == "baseColorFactor") beginFloatArray(model.materials.back().pbrMetallicRoughness->baseColorFactor);
+						else return skip();
+						return true;
+					case State::Animation:
+						if (key == "samplers") stack.push_back(State::AnimationSamplers);
+						else if (key == "channels") stack.push_back(State::Channels);
+						else return skip();
+						return true;
+					case State::Skin:
+						if (key == "joints") beginIntArray(model.skins.back().joints);
+						else return skip();
+						return true;
+					default:
+						return skip();
+				}
+			}
+
+			bool EndArray(SizeType)
+			{
+				if (top() == State::Skip && --skipDepth > 0)
+				{
+					return true;
+				}
+				stack.pop_back();
+				return true;
+			}
+
+		};
+	}
+
+	std::optional<Model> loadStreaming(const std::string &gltfPath, std::string_view jsonData, LoadObserver *observer)
+	{
+		Model model(gltfPath);
+		PhaseTimer phases(observer);
+
+		auto text = std::make_shared<std::vector<char>>();
+		text->reserve(jsonData.size() + 1);
+		text->assign(jsonData.begin(), jsonData.end());
+		text->push_back('\0');
+		model.storage.data = text;
+
+		ModelHandler handler(model);
+		InsituStringStream stream(text->data());
+
+		Reader reader;
+		if (reader.Parse<kParseInsituFlag>(stream, handler).IsError())
+		{
+			return std::nullopt;
+		}
+		phases.end(LoadPhase::PARSE, jsonData.size());
+		return model;
+	}
+}}
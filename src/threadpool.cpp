@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "threadpool.h"
+
+using namespace Boiler::gltf;
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	threadCount = std::max(1u, threadCount);
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back([this]() { run(); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	available.notify_all();
+
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	available.notify_one();
+}
+
+void ThreadPool::run()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+namespace
+{
+	// the pool and queue index of the worker running on this thread
+	thread_local const WorkStealingPool *currentPool = nullptr;
+	thread_local unsigned int currentQueue = 0;
+}
+
+WorkStealingPool::WorkStealingPool(unsigned int threadCount)
+{
+	threadCount = std::max(1u, threadCount);
+	queues.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		queues.push_back(std::make_unique<Queue>());
+	}
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back([this, i]() { run(i); });
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	available.notify_all();
+
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void WorkStealingPool::submit(std::function<void()> task)
+{
+	const unsigned int index = currentPool == this
+		? currentQueue
+		: nextQueue.fetch_add(1, std::memory_order_relaxed) % size();
+	{
+		std::lock_guard<std::mutex> lock(queues[index]->mutex);
+		queues[index]->tasks.push_back(std::move(task));
+	}
+	pending.fetch_add(1);
+
+	// taking the lock orders this against a worker checking pending before it sleeps
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+	}
+	available.notify_one();
+}
+
+bool WorkStealingPool::runOne(unsigned int index)
+{
+	std::function<void()> task;
+	{
+		Queue &own = *queues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+		}
+	}
+
+	for (unsigned int i = 1; !task && i < size(); ++i)
+	{
+		Queue &victim = *queues[(index + i) % size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+		}
+	}
+
+	if (!task)
+	{
+		return false;
+	}
+	pending.fetch_sub(1);
+	task();
+	return true;
+}
+
+void WorkStealingPool::run(unsigned int index)
+{
+	currentPool = this;
+	currentQueue = index;
+	while (true)
+	{
+		if (runOne(index))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		available.wait(lock, [this]() { return stopping || pending.load() > 0; });
+		if (stopping && pending.load() == 0)
+		{
+			return;
+		}
+	}
+}
+
+namespace
+{
+	struct ParallelFor
+	{
+		std::function<void(size_t, size_t)> body;
+		size_t count;
+		size_t chunkSize;
+		size_t chunkCount;
+		std::atomic<size_t> next{0};
+		std::atomic<size_t> finished{0};
+		std::mutex mutex;
+		std::condition_variable done;
+
+		// claims and runs chunks until none are left
+		void work()
+		{
+			for (size_t chunk = next++; chunk < chunkCount; chunk = next++)
+			{
+				const size_t begin = chunk * chunkSize;
+				body(begin, std::min(count, begin + chunkSize));
+				if (++finished == chunkCount)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					done.notify_all();
+				}
+			}
+		}
+	};
+}
+
+void Boiler::gltf::parallelFor(Executor *executor, size_t count, size_t grain,
+							   const std::function<void(size_t, size_t)> &body)
+{
+	grain = std::max<size_t>(1, grain);
+	const unsigned int threads = executor ? executor->concurrency() : 1;
+	if (count == 0)
+	{
+		return;
+	}
+	if (!executor || threads <= 1 || count <= grain)
+	{
+		body(0, count);
+		return;
+	}
+
+	// a few chunks per thread evens out uneven work without much overhead
+	auto state = std::make_shared<ParallelFor>();
+	state->body = body;
+	state->count = count;
+	state->chunkSize = std::max(grain, (count + threads * 4 - 1) / (threads * 4));
+	state->chunkCount = (count + state->chunkSize - 1) / state->chunkSize;
+
+	// helpers that start after the work is gone only touch the shared state
+	const size_t helpers = std::min<size_t>(threads, state->chunkCount - 1);
+	for (size_t i = 0; i < helpers; ++i)
+	{
+		executor->submit([state]() { state->work(); });
+	}
+	state->work();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&state]() { return state->finished == state->chunkCount; });
+}
@@ -0,0 +1,96 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Boiler { namespace gltf
+{
+	// Anything that can run tasks asynchronously. Loaders take an Executor so
+	// callers can plug in the thread pool they already have.
+	class Executor
+	{
+	public:
+		virtual ~Executor() = default;
+		virtual void submit(std::function<void()> task) = 0;
+		// how many tasks can usefully run at once
+		virtual unsigned int concurrency() const { return 1; }
+	};
+
+	// Fixed set of worker threads pulling from a shared queue. Tasks still
+	// queued when the pool is destroyed are run before it returns.
+	class ThreadPool : public Executor
+	{
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable available;
+		bool stopping = false;
+
+		void run();
+
+	public:
+		explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+		~ThreadPool();
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		void submit(std::function<void()> task) override;
+		unsigned int concurrency() const override { return size(); }
+		unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+	};
+
+	// Workers each own a deque of tasks. Tasks submitted from a worker go to
+	// the back of its own deque and it runs them newest first, while idle
+	// workers steal the oldest tasks from the others, so a task that fans out
+	// keeps its follow-up work local. Tasks from other threads are dealt out
+	// round robin. Tasks still queued when the pool is destroyed are run
+	// before it returns.
+	class WorkStealingPool : public Executor
+	{
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> workers;
+		// tasks submitted but not yet taken, so sleepers know to wake
+		std::atomic<size_t> pending{0};
+		std::atomic<unsigned int> nextQueue{0};
+		std::mutex mutex;
+		std::condition_variable available;
+		bool stopping = false;
+
+		bool runOne(unsigned int index);
+		void run(unsigned int index);
+
+	public:
+		explicit WorkStealingPool(unsigned int threadCount = std::thread::hardware_concurrency());
+		~WorkStealingPool();
+		WorkStealingPool(const WorkStealingPool &) = delete;
+		WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+		void submit(std::function<void()> task) override;
+		unsigned int concurrency() const override { return size(); }
+		// queues is complete before any worker starts, workers may still be growing
+		unsigned int size() const { return static_cast<unsigned int>(queues.size()); }
+	};
+
+	// Calls body(begin, end) over [0, count) in chunks of at least grain
+	// elements, on the executor's threads and the calling thread, and returns
+	// once every chunk is done. Runs inline without an executor or when count
+	// fits in one chunk. The caller works too, so this is safe to call from
+	// one of the executor's own tasks.
+	void parallelFor(Executor *executor, size_t count, size_t grain,
+					 const std::function<void(size_t, size_t)> &body);
+}}
+
+#endif /* THREADPOOL_H */
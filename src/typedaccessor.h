@@ -1,86 +1,147 @@
 #ifndef TYPEDACCESSOR_H
 #define TYPEDACCESSOR_H
 
+#include <cstddef>
+#include <iterator>
 #include "gltf.h"
 
 namespace Boiler { namespace gltf
 {
-	template<typename ComponentType, unsigned short NumComponents>
+	// Packed accessors have elements of exactly NumComponents components back
+	// to back, which makes the stride a compile-time constant.
+	template<typename ComponentType, unsigned short NumComponents, bool Packed = false>
 	class TypedAccessor
 	{
-		const BufferView &bufferView;
-		const std::vector<std::byte> &data;
+		static constexpr std::ptrdiff_t packedStride = sizeof(ComponentType) * NumComponents;
 
+		const std::byte *base;
+		std::ptrdiff_t stride;
+
+	public:
+		// Random access iterator over the accessor's elements. Dereferencing
+		// yields a pointer to the element's NumComponents components.
 		class TypedIterator
 		{
-			size_t position;
-			const std::vector<std::byte> &data;
-			const Accessor &accessor;
-			const BufferView &bufferView;
+			const std::byte *element;
+			std::ptrdiff_t stride;
 
-			inline size_t offset()
+			std::ptrdiff_t step() const
 			{
-				unsigned int stride = bufferView.byteStride.has_value()
-					? bufferView.byteStride.value()
-					: sizeof(ComponentType) * NumComponents;
-
-				size_t offset = position * stride + (accessor.byteOffset + bufferView.byteOffset);
-				return offset;
+				if constexpr (Packed)
+				{
+					return packedStride;
+				}
+				else
+				{
+					return stride;
+				}
 			}
 
 		public:
-			TypedIterator(size_t position, const std::vector<std::byte> &data,
-						  const Accessor &accessor, const BufferView &bufferView)
-				: data(data), accessor(accessor), bufferView(bufferView)
+			using iterator_concept = std::random_access_iterator_tag;
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = const ComponentType *;
+			using difference_type = std::ptrdiff_t;
+			using reference = const ComponentType *;
+			using pointer = void;
+
+			TypedIterator() : element(nullptr), stride(0)
 			{
-				this->position = position;
 			}
 
-			TypedIterator &operator++()
+			TypedIterator(const std::byte *element, std::ptrdiff_t stride)
+				: element(element), stride(stride)
 			{
-				++position;
-				return *this;
 			}
 
-			bool operator!=(const TypedIterator &iterator) const
+			const ComponentType *operator*() const
 			{
-				return this->position != iterator.position;
+				return reinterpret_cast<const ComponentType *>(element);
 			}
 
-			const ComponentType *operator*()
+			const ComponentType *operator[](difference_type offset) const
+			{
+				return reinterpret_cast<const ComponentType *>(element + offset * step());
+			}
+
+			TypedIterator &operator++() { element += step(); return *this; }
+			TypedIterator &operator--() { element -= step(); return *this; }
+			TypedIterator operator++(int) { TypedIterator previous = *this; element += step(); return previous; }
+			TypedIterator operator--(int) { TypedIterator previous = *this; element -= step(); return previous; }
+
+			TypedIterator &operator+=(difference_type offset) { element += offset * step(); return *this; }
+			TypedIterator &operator-=(difference_type offset) { element -= offset * step(); return *this; }
+
+			friend TypedIterator operator+(TypedIterator iterator, difference_type offset) { return iterator += offset; }
+			friend TypedIterator operator+(difference_type offset, TypedIterator iterator) { return iterator += offset; }
+			friend TypedIterator operator-(TypedIterator iterator, difference_type offset) { return iterator -= offset; }
+
+			friend difference_type operator-(const TypedIterator &lhs, const TypedIterator &rhs)
 			{
-				return (reinterpret_cast<const ComponentType *>(data.data() + offset()));
+				return lhs.step() ? (lhs.element - rhs.element) / lhs.step() : 0;
 			}
+
+			bool operator==(const TypedIterator &other) const { return element == other.element; }
+			auto operator<=>(const TypedIterator &other) const { return element <=> other.element; }
 		};
 
-	public:
+		using iterator = TypedIterator;
+		using const_iterator = TypedIterator;
+
 		const Accessor &accessor;
 
-		TypedAccessor(const Accessor &accessor, const BufferView &bufferView, const std::vector<std::byte> &data)
-			: accessor(accessor), bufferView(bufferView), data(data)
+		TypedAccessor(const Accessor &accessor, const BufferView &bufferView, ByteSpan data)
+			: base(data.data() + (accessor.byteOffset + bufferView.byteOffset)),
+			  stride(Packed ? packedStride : bufferView.byteStride.value_or(packedStride)),
+			  accessor(accessor)
 		{
 		}
 
-		const ComponentType *operator[](int index) const
+		const ComponentType *operator[](size_t index) const
 		{
-			return *TypedIterator(index, data, accessor, bufferView);
+			return reinterpret_cast<const ComponentType *>(base + index * byteStride());
 		}
 
 		TypedIterator begin() const
 		{
-			return TypedIterator(0, data, accessor, bufferView);
+			return TypedIterator(base, stride);
 		}
 
 		TypedIterator end() const
 		{
-			bufferView.byteStride.has_value() ? bufferView.byteStride.value()
-				: sizeof(ComponentType) * NumComponents;
-
-			unsigned int last = accessor.count;
-			return TypedIterator(last, data, accessor, bufferView);
+			return TypedIterator(base + accessor.count * byteStride(), stride);
 		}
 
 		size_t size() const { return accessor.count; }
+
+		std::ptrdiff_t byteStride() const
+		{
+			if constexpr (Packed)
+			{
+				return packedStride;
+			}
+			else
+			{
+				return stride;
+			}
+		}
+
+		bool isContiguous() const
+		{
+			return byteStride() == packedStride;
+		}
+
+		// All size() * NumComponents components as one flat span when the
+		// elements are tightly packed, which lets loops over them vectorize.
+		std::optional<std::span<const ComponentType>> contiguous() const
+		{
+			if (!isContiguous())
+			{
+				return std::nullopt;
+			}
+			return std::span<const ComponentType>(reinterpret_cast<const ComponentType *>(base),
+												  size() * NumComponents);
+		}
 	};
 }}
 
@@ -0,0 +1,418 @@
+#include <cstring>
+#include "validator.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	bool isComponentType(ComponentType componentType)
+	{
+		switch (componentType)
+		{
+			case ComponentType::BYTE:
+			case ComponentType::UNSIGNED_BYTE:
+			case ComponentType::SHORT:
+			case ComponentType::UNSIGNED_SHORT:
+			case ComponentType::UNSIGNED_INT:
+			case ComponentType::FLOAT:
+				return true;
+		}
+		return false;
+	}
+
+	bool isIndexType(ComponentType componentType)
+	{
+		return componentType == ComponentType::UNSIGNED_BYTE || componentType == ComponentType::UNSIGNED_SHORT
+			|| componentType == ComponentType::UNSIGNED_INT;
+	}
+
+	// largest of count indices at data, stride bytes apart
+	template<typename Index>
+	uint32_t maxIndex(const std::byte *data, size_t count, size_t stride)
+	{
+		Index largest = 0;
+		if (stride == sizeof(Index))
+		{
+			// packed, which the compiler vectorizes
+			for (size_t i = 0; i < count; ++i)
+			{
+				Index value;
+				std::memcpy(&value, data + i * sizeof(Index), sizeof(Index));
+				largest = value > largest ? value : largest;
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				Index value;
+				std::memcpy(&value, data + i * stride, sizeof(Index));
+				largest = value > largest ? value : largest;
+			}
+		}
+		return largest;
+	}
+
+	class Validator
+	{
+		const Model &model;
+		const std::vector<ByteSpan> &buffers;
+		std::vector<ValidationError> &errors;
+		// per bufferView and accessor, whether its data can be read
+		std::vector<bool> viewValid, accessorValid;
+
+		void fail(ValidationCode code, const char *table, size_t index, size_t subIndex, std::string message)
+		{
+			errors.push_back(ValidationError{code, table, index, subIndex, std::move(message)});
+		}
+
+		// the bytes of bufferView view from offset on, which must already be valid
+		ByteSpan viewBytes(size_t view, size_t offset) const
+		{
+			const BufferView &bufferView = model.bufferViews[view];
+			return buffers[bufferView.buffer].subspan(bufferView.byteOffset + offset, viewLength(bufferView) - offset);
+		}
+
+		size_t viewLength(const BufferView &bufferView) const
+		{
+			const size_t bufferLength = model.buffers[bufferView.buffer].byteLength;
+			return bufferView.byteLength.value_or(bufferLength > bufferView.byteOffset
+												  ? bufferLength - bufferView.byteOffset : 0);
+		}
+
+	public:
+		Validator(const Model &model, const std::vector<ByteSpan> &buffers, std::vector<ValidationError> &errors)
+			: model(model), buffers(buffers), errors(errors)
+		{
+		}
+
+		void checkBuffers()
+		{
+			for (size_t i = 0; i < model.buffers.size(); ++i)
+			{
+				const size_t loaded = buffers[i].size();
+				const size_t byteLength = model.buffers[i].byteLength;
+				if (loaded == 0 && byteLength > 0)
+				{
+					fail(ValidationCode::BufferMissing, "buffers", i, 0, "no data loaded");
+				}
+				else if (loaded < byteLength)
+				{
+					fail(ValidationCode::BufferTooShort, "buffers", i, 0,
+						 std::to_string(loaded) + " bytes loaded of " + std::to_string(byteLength));
+				}
+			}
+		}
+
+		void checkBufferViews()
+		{
+			viewValid.assign(model.bufferViews.size(), false);
+			for (size_t i = 0; i < model.bufferViews.size(); ++i)
+			{
+				const BufferView &bufferView = model.bufferViews[i];
+				if (bufferView.buffer < 0 || static_cast<size_t>(bufferView.buffer) >= model.buffers.size())
+				{
+					fail(ValidationCode::BufferViewBuffer, "bufferViews", i, 0,
+						 "buffer " + std::to_string(bufferView.buffer) + " doesn't exist");
+					continue;
+				}
+
+				// against the loaded data too, which may be shorter than declared
+				const size_t available = std::min<size_t>(model.buffers[bufferView.buffer].byteLength,
+														  buffers[bufferView.buffer].size());
+				const size_t length = viewLength(bufferView);
+				bool valid = true;
+				if (bufferView.byteOffset > available || length > available - bufferView.byteOffset)
+				{
+					fail(ValidationCode::BufferViewOutOfBounds, "bufferViews", i, 0,
+						 "bytes [" + std::to_string(bufferView.byteOffset) + ", "
+						 + std::to_string(size_t(bufferView.byteOffset) + length) + ") of a "
+						 + std::to_string(available) + " byte buffer");
+					valid = false;
+				}
+				if (bufferView.byteStride.has_value()
+					&& (bufferView.byteStride.value() < 4 || bufferView.byteStride.value() > 252
+						|| bufferView.byteStride.value() % 4 != 0))
+				{
+					fail(ValidationCode::BufferViewStride, "bufferViews", i, 0,
+						 "byteStride " + std::to_string(bufferView.byteStride.value()));
+					valid = false;
+				}
+				viewValid[i] = valid;
+			}
+		}
+
+		// a sparse indices or values block of bytes bytes, aligned to alignment
+		bool checkSparseBlock(size_t accessor, size_t view, size_t offset, size_t bytes, size_t alignment,
+							  const char *what)
+		{
+			if (view >= model.bufferViews.size() || !viewValid[view])
+			{
+				fail(ValidationCode::AccessorBufferView, "accessors", accessor, 0,
+					 std::string("sparse ") + what + " bufferView " + std::to_string(view) + " is missing or invalid");
+				return false;
+			}
+			const BufferView &bufferView = model.bufferViews[view];
+			const size_t length = viewLength(bufferView);
+			const uintptr_t address = reinterpret_cast<uintptr_t>(buffers[bufferView.buffer].data())
+				+ bufferView.byteOffset + offset;
+			if (offset > length || bytes > length - offset || address % alignment != 0)
+			{
+				fail(ValidationCode::SparseOutOfBounds, "accessors", accessor, 0,
+					 std::string("sparse ") + what + " don't fit bufferView " + std::to_string(view));
+				return false;
+			}
+			return true;
+		}
+
+		void checkSparse(size_t i, const Accessor &accessor, size_t elementBytes)
+		{
+			const Sparse &sparse = accessor.sparse.value();
+			if (!isIndexType(sparse.indices.componentType))
+			{
+				fail(ValidationCode::SparseIndicesType, "accessors", i, 0, "sparse indices aren't unsigned integers");
+				accessorValid[i] = false;
+				return;
+			}
+
+			const size_t indexBytes = componentSize(sparse.indices.componentType);
+			const bool indicesFit = checkSparseBlock(i, sparse.indices.bufferView, sparse.indices.byteOffset,
+													 sparse.count * indexBytes, indexBytes, "indices");
+			const bool valuesFit = checkSparseBlock(i, sparse.values.bufferView, sparse.values.byteOffset,
+													sparse.count * elementBytes, componentSize(accessor.componentType),
+													"values");
+			if (!indicesFit || !valuesFit)
+			{
+				accessorValid[i] = false;
+				return;
+			}
+
+			const std::byte *indices = viewBytes(sparse.indices.bufferView, sparse.indices.byteOffset).data();
+			const auto loadIndex = [&](size_t k) -> uint32_t
+			{
+				switch (sparse.indices.componentType)
+				{
+					case ComponentType::UNSIGNED_BYTE: return convert::load<uint8_t>(indices + k);
+					case ComponentType::UNSIGNED_SHORT: return convert::load<uint16_t>(indices + k * 2);
+					default: return convert::load<uint32_t>(indices + k * 4);
+				}
+			};
+			for (size_t k = 0; k < sparse.count; ++k)
+			{
+				const uint32_t index = loadIndex(k);
+				if (index >= accessor.count || (k > 0 && index <= loadIndex(k - 1)))
+				{
+					fail(ValidationCode::SparseIndexRange, "accessors", i, 0,
+						 "sparse index " + std::to_string(k) + " is " + std::to_string(index));
+					accessorValid[i] = false;
+					return;
+				}
+			}
+		}
+
+		void checkAccessors()
+		{
+			accessorValid.assign(model.accessors.size(), true);
+			for (size_t i = 0; i < model.accessors.size(); ++i)
+			{
+				const Accessor &accessor = model.accessors[i];
+				if (!isComponentType(accessor.componentType))
+				{
+					fail(ValidationCode::AccessorComponentType, "accessors", i, 0,
+						 "componentType " + std::to_string(static_cast<int>(accessor.componentType)));
+					accessorValid[i] = false;
+					continue;
+				}
+
+				const size_t elementBytes = elementSize(accessor.componentType, accessor.type);
+				if (accessor.bufferView.has_value())
+				{
+					const size_t view = accessor.bufferView.value();
+					if (view >= model.bufferViews.size() || !viewValid[view])
+					{
+						fail(ValidationCode::AccessorBufferView, "accessors", i, 0,
+							 "bufferView " + std::to_string(view) + " is missing or invalid");
+						accessorValid[i] = false;
+						continue;
+					}
+
+					const BufferView &bufferView = model.bufferViews[view];
+					const size_t stride = bufferView.byteStride.value_or(elementBytes);
+					const size_t length = viewLength(bufferView);
+					const size_t extent = accessor.count ? (accessor.count - 1) * stride + elementBytes : 0;
+					const size_t alignment = componentSize(accessor.componentType);
+					if (stride < elementBytes)
+					{
+						fail(ValidationCode::AccessorStride, "accessors", i, 0,
+							 "byteStride " + std::to_string(stride) + " is less than the "
+							 + std::to_string(elementBytes) + " byte element");
+						accessorValid[i] = false;
+					}
+					else if (accessor.byteOffset > length || extent > length - accessor.byteOffset)
+					{
+						fail(ValidationCode::AccessorOutOfBounds, "accessors", i, 0,
+							 std::to_string(accessor.count) + " elements from byte " + std::to_string(accessor.byteOffset)
+							 + " need " + std::to_string(accessor.byteOffset + extent) + " of "
+							 + std::to_string(length) + " bytes");
+						accessorValid[i] = false;
+					}
+					else if ((reinterpret_cast<uintptr_t>(buffers[bufferView.buffer].data()) + bufferView.byteOffset
+							  + accessor.byteOffset) % alignment != 0 || stride % alignment != 0)
+					{
+						fail(ValidationCode::AccessorMisaligned, "accessors", i, 0,
+							 "not aligned to its " + std::to_string(alignment) + " byte components");
+						accessorValid[i] = false;
+					}
+				}
+
+				if (accessor.sparse.has_value())
+				{
+					checkSparse(i, accessor, elementBytes);
+				}
+			}
+		}
+
+		// the accessor's index if it's valid, with an error for the primitive otherwise
+		std::optional<size_t> primitiveAccessor(int accessor, size_t mesh, size_t primitive, const std::string &what)
+		{
+			if (accessor < 0 || static_cast<size_t>(accessor) >= model.accessors.size())
+			{
+				fail(ValidationCode::PrimitiveAccessor, "meshes", mesh, primitive,
+					 what + " accessor " + std::to_string(accessor) + " doesn't exist");
+				return std::nullopt;
+			}
+			return accessorValid[accessor] ? std::optional<size_t>(accessor) : std::nullopt;
+		}
+
+		void checkPrimitive(size_t mesh, size_t p, const Primitive &primitive)
+		{
+			std::optional<size_t> vertexCount;
+			const auto checkCount = [&](const std::string &name, int index)
+			{
+				const std::optional<size_t> accessor = primitiveAccessor(index, mesh, p, name);
+				if (!accessor.has_value())
+				{
+					return;
+				}
+				const size_t count = model.accessors[accessor.value()].count;
+				if (!vertexCount.has_value())
+				{
+					vertexCount = count;
+				}
+				else if (count != vertexCount.value())
+				{
+					fail(ValidationCode::PrimitiveCountMismatch, "meshes", mesh, p,
+						 name + " has " + std::to_string(count) + " elements, not "
+						 + std::to_string(vertexCount.value()));
+				}
+			};
+
+			for (const auto &[name, index] : primitive.attributes)
+			{
+				checkCount(std::string(name), index);
+			}
+			for (const auto &target : primitive.targets)
+			{
+				for (const auto &[name, index] : target)
+				{
+					checkCount("target " + std::string(name), index);
+				}
+			}
+
+			if (!primitive.indices.has_value())
+			{
+				return;
+			}
+			const std::optional<size_t> indices = primitiveAccessor(primitive.indices.value(), mesh, p, "indices");
+			if (!indices.has_value())
+			{
+				return;
+			}
+			const Accessor &accessor = model.accessors[indices.value()];
+			if (accessor.type != AccessorType::SCALAR || !isIndexType(accessor.componentType)
+				|| !accessor.bufferView.has_value() || accessor.sparse.has_value())
+			{
+				fail(ValidationCode::PrimitiveIndicesType, "meshes", mesh, p,
+					 "indices must be a SCALAR unsigned integer accessor with data and no sparse values");
+				return;
+			}
+
+			const BufferView &bufferView = model.bufferViews[accessor.bufferView.value()];
+			const size_t stride = bufferView.byteStride.value_or(componentSize(accessor.componentType));
+			const std::byte *data = viewBytes(accessor.bufferView.value(), accessor.byteOffset).data();
+			uint32_t largest = 0;
+			switch (accessor.componentType)
+			{
+				case ComponentType::UNSIGNED_BYTE: largest = maxIndex<uint8_t>(data, accessor.count, stride); break;
+				case ComponentType::UNSIGNED_SHORT: largest = maxIndex<uint16_t>(data, accessor.count, stride); break;
+				default: largest = maxIndex<uint32_t>(data, accessor.count, stride); break;
+			}
+			if (accessor.count > 0 && largest >= vertexCount.value_or(0))
+			{
+				fail(ValidationCode::IndexOutOfRange, "meshes", mesh, p,
+					 "index " + std::to_string(largest) + " with " + std::to_string(vertexCount.value_or(0)) + " vertices");
+			}
+		}
+
+		void checkMeshes()
+		{
+			for (size_t mesh = 0; mesh < model.meshes.size(); ++mesh)
+			{
+				const auto &primitives = model.meshes[mesh].primitives;
+				for (size_t p = 0; p < primitives.size(); ++p)
+				{
+					checkPrimitive(mesh, p, primitives[p]);
+				}
+			}
+		}
+	};
+}
+
+const char *Boiler::gltf::validationCodeName(ValidationCode code)
+{
+	switch (code)
+	{
+		case ValidationCode::BufferMissing: return "BufferMissing";
+		case ValidationCode::BufferTooShort: return "BufferTooShort";
+		case ValidationCode::BufferViewBuffer: return "BufferViewBuffer";
+		case ValidationCode::BufferViewOutOfBounds: return "BufferViewOutOfBounds";
+		case ValidationCode::BufferViewStride: return "BufferViewStride";
+		case ValidationCode::AccessorComponentType: return "AccessorComponentType";
+		case ValidationCode::AccessorBufferView: return "AccessorBufferView";
+		case ValidationCode::AccessorStride: return "AccessorStride";
+		case ValidationCode::AccessorOutOfBounds: return "AccessorOutOfBounds";
+		case ValidationCode::AccessorMisaligned: return "AccessorMisaligned";
+		case ValidationCode::SparseIndicesType: return "SparseIndicesType";
+		case ValidationCode::SparseOutOfBounds: return "SparseOutOfBounds";
+		case ValidationCode::SparseIndexRange: return "SparseIndexRange";
+		case ValidationCode::PrimitiveAccessor: return "PrimitiveAccessor";
+		case ValidationCode::PrimitiveCountMismatch: return "PrimitiveCountMismatch";
+		case ValidationCode::PrimitiveIndicesType: return "PrimitiveIndicesType";
+		case ValidationCode::IndexOutOfRange: return "IndexOutOfRange";
+	}
+	return "Unknown";
+}
+
+ValidationResult Boiler::gltf::validate(const Model &model, BufferSources sources)
+{
+	sources.resize(std::max(sources.size(), model.buffers.size()));
+	std::vector<ByteSpan> buffers;
+	buffers.reserve(sources.size());
+	for (const auto &source : sources)
+	{
+		buffers.push_back(source ? source->data() : ByteSpan());
+	}
+
+	ValidationResult result;
+	Validator validator(model, buffers, result.errors);
+	validator.checkBuffers();
+	validator.checkBufferViews();
+	validator.checkAccessors();
+	validator.checkMeshes();
+
+	if (result.errors.empty())
+	{
+		result.model.emplace(ValidatedModel(ModelAccessors(model, std::move(sources))));
+	}
+	return result;
+}
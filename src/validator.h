@@ -0,0 +1,144 @@
+#ifndef VALIDATOR_H
+#define VALIDATOR_H
+
+#include <optional>
+#include <string>
+#include <vector>
+#include "buffersource.h"
+#include "gltf.h"
+#include "modelaccessors.h"
+
+namespace Boiler { namespace gltf
+{
+	enum class ValidationCode
+	{
+		BufferMissing,				// no data was loaded for the buffer
+		BufferTooShort,				// fewer bytes loaded than byteLength
+		BufferViewBuffer,			// buffer index out of range
+		BufferViewOutOfBounds,		// byteOffset + byteLength past the buffer
+		BufferViewStride,			// byteStride not a multiple of 4 in [4, 252]
+		AccessorComponentType,		// not one of the six component types
+		AccessorBufferView,			// bufferView index out of range
+		AccessorStride,				// byteStride smaller than an element
+		AccessorOutOfBounds,		// last element past the bufferView
+		AccessorMisaligned,			// offset not a multiple of the component size
+		SparseIndicesType,			// sparse indices not an unsigned integer type
+		SparseOutOfBounds,			// sparse indices or values past their bufferView
+		SparseIndexRange,			// sparse index not below count or not increasing
+		PrimitiveAccessor,			// attribute, target or indices accessor out of range
+		PrimitiveCountMismatch,		// attributes or targets with different counts
+		PrimitiveIndicesType,		// indices not unsigned SCALAR, or sparse
+		IndexOutOfRange				// an index at or past the vertex count
+	};
+
+	const char *validationCodeName(ValidationCode code);
+
+	struct ValidationResult;
+
+	struct ValidationError
+	{
+		ValidationCode code;
+		// "buffers", "bufferViews", "accessors" or "meshes", and the index into it
+		const char *table;
+		size_t index;
+		// the primitive within a mesh, 0 otherwise
+		size_t subIndex;
+		std::string message;
+	};
+
+	// A model whose buffers, bufferViews and accessors have all been checked
+	// against the loaded data, and whose primitives' indices are all below
+	// their vertex counts. Its accessors need no checks at all: the only one
+	// left is that the requested C and N are exactly the accessor's, once per
+	// accessor rather than per element. Refers to the model, which must
+	// outlive it.
+	class ValidatedModel
+	{
+		ModelAccessors accessors;
+
+		explicit ValidatedModel(ModelAccessors accessors) : accessors(std::move(accessors)) {}
+		friend ValidationResult validate(const Model &model, BufferSources sources);
+
+		template<typename ComponentType, unsigned short NumComponents>
+		bool matches(const Accessor &accessor) const
+		{
+			// padded matrix columns aren't NumComponents packed components
+			return accessor.bufferView.has_value() && !accessor.sparse.has_value()
+				&& accessor.componentType == ComponentTypeOf<ComponentType>::value
+				&& componentCount(accessor.type) == NumComponents
+				&& elementSize(accessor.componentType, accessor.type) == sizeof(ComponentType) * NumComponents;
+		}
+
+	public:
+		const Model &getModel() const { return accessors.getModel(); }
+		// for anything not wrapped here, all of it safe on this model
+		const ModelAccessors &getAccessors() const { return accessors; }
+
+		// nullopt if the accessor has no bufferView, is sparse, or its elements
+		// aren't NumComponents packed components of exactly ComponentType
+		template<typename ComponentType, unsigned short NumComponents>
+		std::optional<TypedAccessor<ComponentType, NumComponents>> getTypedAccessor(unsigned int accessorIndex) const
+		{
+			const Model &model = accessors.getModel();
+			if (accessorIndex >= model.accessors.size()
+				|| !matches<ComponentType, NumComponents>(model.accessors[accessorIndex]))
+			{
+				return std::nullopt;
+			}
+			return accessors.getTypedAccessor<ComponentType, NumComponents>(model.accessors[accessorIndex]);
+		}
+
+		template<typename ComponentType, unsigned short NumComponents>
+		std::optional<TypedAccessor<ComponentType, NumComponents>> getTypedAccessor(const Primitive &primitive,
+																					Attribute attribute) const
+		{
+			const std::optional<int> found = primitive.attributes.find(attribute);
+			if (!found.has_value())
+			{
+				return std::nullopt;
+			}
+			return getTypedAccessor<ComponentType, NumComponents>(static_cast<unsigned int>(*found));
+		}
+
+		template<typename ComponentType, unsigned short NumComponents>
+		std::optional<TypedAccessor<ComponentType, NumComponents>> getTypedAccessor(const Primitive &primitive,
+																					std::string_view attribute) const
+		{
+			const std::optional<int> found = primitive.attributes.find(attribute);
+			if (!found.has_value())
+			{
+				return std::nullopt;
+			}
+			return getTypedAccessor<ComponentType, NumComponents>(static_cast<unsigned int>(*found));
+		}
+
+		template<typename Visitor>
+		bool visitAccessor(unsigned int accessorIndex, Visitor &&visitor) const
+		{
+			return accessors.visitAccessor(accessorIndex, std::forward<Visitor>(visitor));
+		}
+
+		template<typename T>
+		bool readAccessor(unsigned int accessorIndex, std::span<T> out) const
+		{
+			return accessorIndex < getModel().accessors.size() && accessors.readAccessor(accessorIndex, out);
+		}
+	};
+
+	struct ValidationResult
+	{
+		std::vector<ValidationError> errors;
+		// set when there are no errors
+		std::optional<ValidatedModel> model;
+
+		bool ok() const { return errors.empty(); }
+	};
+
+	// Checks every buffer, bufferView and accessor against sources, which
+	// hold the loaded data indexed like model.buffers, and every primitive's
+	// accessors and index values, in one pass over each table. Collects every
+	// error rather than stopping at the first.
+	ValidationResult validate(const Model &model, BufferSources sources);
+}}
+
+#endif /* VALIDATOR_H */
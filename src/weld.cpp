@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "baked.h"
+#include "indexbuffers.h"
+#include "modelaccessors.h"
+#include "threadpool.h"
+#include "weld.h"
+
+using namespace Boiler::gltf;
+
+namespace
+{
+	constexpr uint32_t none = ~0u;
+	// vertices per task when building keys
+	constexpr size_t parallelGrain = 16384;
+
+	// Where one attribute's element goes in a vertex's key. With an epsilon,
+	// each float component is stored as the 64-bit index of its grid cell.
+	struct KeyPart
+	{
+		const PackedAttribute *attribute;
+		float epsilon;
+		size_t offset;
+	};
+
+	void writeKeyPart(const KeyPart &part, size_t vertex, std::byte *key)
+	{
+		const PackedAttribute &attribute = *part.attribute;
+		const size_t bytes = attribute.elementBytes();
+		const std::byte *element = attribute.data.data() + vertex * bytes;
+		if (part.epsilon <= 0.0f)
+		{
+			std::memcpy(key + part.offset, element, bytes);
+			return;
+		}
+
+		const unsigned int components = componentCount(attribute.type);
+		for (unsigned int c = 0; c < components; ++c)
+		{
+			float value;
+			std::memcpy(&value, element + c * sizeof(float), sizeof(float));
+			const double scaled = static_cast<double>(value) / part.epsilon;
+			int64_t cell;
+			if (std::abs(scaled) < 0x1p62)
+			{
+				cell = std::llround(scaled);
+			}
+			else
+			{
+				// infinities, NaNs and values too far out for a cell only weld
+				// with the same bits
+				uint32_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				cell = std::numeric_limits<int64_t>::min() + bits;
+			}
+			std::memcpy(key + part.offset + c * sizeof(cell), &cell, sizeof(cell));
+		}
+	}
+
+	size_t keyPartBytes(const KeyPart &part)
+	{
+		return part.epsilon > 0.0f ? componentCount(part.attribute->type) * sizeof(int64_t) : part.attribute->elementBytes();
+	}
+
+	bool readAttributes(const ModelAccessors &accessors, const Attributes &attributes, size_t &vertexCount,
+						std::vector<PackedAttribute> &out)
+	{
+		const Model &model = accessors.getModel();
+		for (const auto &[name, index] : attributes)
+		{
+			if (index < 0 || static_cast<size_t>(index) >= model.accessors.size())
+			{
+				return false;
+			}
+			const Accessor &accessor = model.accessors[index];
+			if (vertexCount == none)
+			{
+				vertexCount = accessor.count;
+			}
+			std::optional<PackedAttribute> packed = PackedAttribute::read(accessors, name, accessor);
+			if (accessor.count != vertexCount || !packed.has_value())
+			{
+				return false;
+			}
+			out.push_back(std::move(packed.value()));
+		}
+		return true;
+	}
+}
+
+std::optional<WeldedPrimitive> WeldedPrimitive::weld(const ModelAccessors &accessors, const Primitive &primitive,
+													 const WeldOptions &options, Executor *executor)
+{
+	WeldedPrimitive welded;
+	size_t sourceCount = none;
+	if (!readAttributes(accessors, primitive.attributes, sourceCount, welded.attributes))
+	{
+		return std::nullopt;
+	}
+	for (const Attributes &target : primitive.targets)
+	{
+		if (!readAttributes(accessors, target, sourceCount, welded.targets.emplace_back()))
+		{
+			return std::nullopt;
+		}
+	}
+	if (sourceCount == none)
+	{
+		return std::nullopt;
+	}
+
+	std::vector<uint32_t> indices;
+	if (primitive.indices.has_value())
+	{
+		const Model &model = accessors.getModel();
+		if (primitive.indices.value() < 0 || static_cast<size_t>(primitive.indices.value()) >= model.accessors.size())
+		{
+			return std::nullopt;
+		}
+		const Accessor &accessor = model.accessors[primitive.indices.value()];
+		indices.resize(accessor.count);
+		if (accessor.type != AccessorType::SCALAR || !accessors.readAccessor(accessor, std::span<uint32_t>(indices))
+			|| std::any_of(indices.begin(), indices.end(), [&](uint32_t index) { return index >= sourceCount; }))
+		{
+			return std::nullopt;
+		}
+	}
+
+	// every attribute and target element of a vertex side by side, padded
+	// to whole words for hashBytes
+	std::vector<KeyPart> parts;
+	size_t keyBytes = 0;
+	const auto addParts = [&](const std::vector<PackedAttribute> &attributes, bool target)
+	{
+		for (const PackedAttribute &attribute : attributes)
+		{
+			float epsilon = 0.0f;
+			if (!target && attribute.componentType == ComponentType::FLOAT)
+			{
+				const Attribute semantic = parseAttribute(attribute.name);
+				epsilon = semantic == Attribute::POSITION ? options.positionEpsilon
+						: semantic == Attribute::NORMAL ? options.normalEpsilon : 0.0f;
+			}
+			const KeyPart &part = parts.emplace_back(KeyPart{&attribute, epsilon, keyBytes});
+			keyBytes += keyPartBytes(part);
+		}
+	};
+	addParts(welded.attributes, false);
+	for (const std::vector<PackedAttribute> &target : welded.targets)
+	{
+		addParts(target, true);
+	}
+	keyBytes = (keyBytes + 7) & ~size_t(7);
+
+	std::vector<std::byte> keys(sourceCount * keyBytes);
+	std::vector<uint64_t> hashes(sourceCount);
+	parallelFor(executor, sourceCount, parallelGrain, [&](size_t begin, size_t end)
+	{
+		for (size_t vertex = begin; vertex < end; ++vertex)
+		{
+			std::byte *key = keys.data() + vertex * keyBytes;
+			for (const KeyPart &part : parts)
+			{
+				writeKeyPart(part, vertex, key);
+			}
+			hashes[vertex] = hashBytes(ByteSpan(key, keyBytes));
+		}
+	});
+
+	// Equal vertices hash alike, so partitioning by the top bits of the hash
+	// lets each partition be welded on its own. Vertices stay in ascending
+	// order within a partition, so each finds the first vertex equal to it
+	// and the result doesn't depend on the partitioning.
+	unsigned int partitionBits = 0;
+	while (partitionBits < 16 && (sourceCount >> partitionBits) > std::max<size_t>(options.partitionVertices, 1))
+	{
+		++partitionBits;
+	}
+	const size_t partitionCount = size_t(1) << partitionBits;
+	const auto partitionOf = [&](size_t vertex) -> size_t
+	{
+		return partitionBits ? hashes[vertex] >> (64 - partitionBits) : 0;
+	};
+	std::vector<size_t> offsets(partitionCount + 1, 0);
+	for (size_t vertex = 0; vertex < sourceCount; ++vertex)
+	{
+		++offsets[partitionOf(vertex) + 1];
+	}
+	for (size_t p = 0; p < partitionCount; ++p)
+	{
+		offsets[p + 1] += offsets[p];
+	}
+	std::vector<uint32_t> order(sourceCount);
+	std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t vertex = 0; vertex < sourceCount; ++vertex)
+	{
+		order[fill[partitionOf(vertex)]++] = static_cast<uint32_t>(vertex);
+	}
+
+	std::vector<uint32_t> first(sourceCount);
+	parallelFor(executor, partitionCount, 1, [&](size_t begin, size_t end)
+	{
+		std::vector<uint32_t> table;
+		for (size_t p = begin; p < end; ++p)
+		{
+			const size_t count = offsets[p + 1] - offsets[p];
+			size_t tableSize = 1;
+			while (tableSize < count * 2)
+			{
+				tableSize *= 2;
+			}
+			table.assign(tableSize, none);
+			const size_t mask = tableSize - 1;
+
+			for (size_t i = offsets[p]; i < offsets[p + 1]; ++i)
+			{
+				const uint32_t vertex = order[i];
+				const std::byte *key = keys.data() + vertex * keyBytes;
+				for (size_t slot = hashes[vertex] & mask;; slot = (slot + 1) & mask)
+				{
+					const uint32_t other = table[slot];
+					if (other == none)
+					{
+						table[slot] = vertex;
+						first[vertex] = vertex;
+						break;
+					}
+					if (hashes[other] == hashes[vertex]
+						&& std::memcmp(keys.data() + other * keyBytes, key, keyBytes) == 0)
+					{
+						first[vertex] = other;
+						break;
+					}
+				}
+			}
+		}
+	});
+
+	welded.remap.resize(sourceCount);
+	uint32_t next = 0;
+	for (size_t vertex = 0; vertex < sourceCount; ++vertex)
+	{
+		welded.remap[vertex] = first[vertex] == vertex ? next++ : welded.remap[first[vertex]];
+	}
+	welded.vertexCount = next;
+
+	for (PackedAttribute &attribute : welded.attributes)
+	{
+		attribute.remap(welded.remap, welded.vertexCount);
+	}
+	for (std::vector<PackedAttribute> &target : welded.targets)
+	{
+		for (PackedAttribute &attribute : target)
+		{
+			attribute.remap(welded.remap, welded.vertexCount);
+		}
+	}
+
+	if (primitive.indices.has_value())
+	{
+		for (uint32_t &index : indices)
+		{
+			index = welded.remap[index];
+		}
+	}
+	else
+	{
+		indices = welded.remap;
+	}
+	welded.indexCount = indices.size();
+	welded.indexType = indexComponentType(welded.vertexCount);
+	encodeIndices(indices, welded.indexType, welded.indices);
+	return welded;
+}
+
+std::vector<std::optional<WeldedPrimitive>> Boiler::gltf::weldPrimitives(const ModelAccessors &accessors,
+																		  const WeldOptions &options, Executor *executor)
+{
+	std::vector<const Primitive *> primitives;
+	for (const Mesh &mesh : accessors.getModel().meshes)
+	{
+		for (const Primitive &primitive : mesh.primitives)
+		{
+			primitives.push_back(&primitive);
+		}
+	}
+
+	// large primitives also weld in parallel inside, which parallelFor
+	// allows from the executor's own tasks
+	std::vector<std::optional<WeldedPrimitive>> results(primitives.size());
+	parallelFor(executor, primitives.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (!primitives[i]->indices.has_value())
+			{
+				results[i] = WeldedPrimitive::weld(accessors, *primitives[i], options, executor);
+			}
+		}
+	});
+	return results;
+}
@@ -0,0 +1,60 @@
+#ifndef WELD_H
+#define WELD_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "gltf.h"
+#include "optimize.h"
+
+namespace Boiler { namespace gltf
+{
+	class Executor;
+	class ModelAccessors;
+
+	struct WeldOptions
+	{
+		// Float POSITION and NORMAL components are compared after rounding to
+		// the nearest multiple of these, so components that round to the same
+		// multiple weld. Values however close on either side of a halfway
+		// point, e.g. 0.4999 and 0.5001 of epsilon, never do. 0 welds bitwise
+		// identical values only.
+		float positionEpsilon = 0.0f;
+		float normalEpsilon = 0.0f;
+		// primitives with more vertices are split into hash partitions that
+		// are welded in parallel
+		size_t partitionVertices = 1 << 16;
+	};
+
+	// A primitive with the vertices that are identical in every attribute and
+	// morph target merged into the first of them, in their original order,
+	// and indices into them in the narrowest type that fits.
+	struct WeldedPrimitive
+	{
+		size_t vertexCount = 0;
+		std::vector<PackedAttribute> attributes;
+		// one per morph target, in the primitive's order
+		std::vector<std::vector<PackedAttribute>> targets;
+		ComponentType indexType = ComponentType::UNSIGNED_INT;
+		size_t indexCount = 0;
+		// indexCount indices of indexType
+		std::vector<std::byte> indices;
+		// each original vertex's welded index
+		std::vector<uint32_t> remap;
+
+		// Welds non-indexed primitives, and indexed ones through their
+		// indices. Returns nullopt if the attributes' counts differ, an
+		// attribute is a matrix or an index is out of range.
+		static std::optional<WeldedPrimitive> weld(const ModelAccessors &accessors, const Primitive &primitive,
+												   const WeldOptions &options = {}, Executor *executor = nullptr);
+	};
+
+	// Welds every non-indexed primitive of the model, primitives in parallel
+	// on the executor. One result per primitive in mesh order, nullopt for
+	// those that are already indexed or can't be welded.
+	std::vector<std::optional<WeldedPrimitive>> weldPrimitives(const ModelAccessors &accessors,
+															   const WeldOptions &options = {},
+															   Executor *executor = nullptr);
+}}
+
+#endif /* WELD_H */